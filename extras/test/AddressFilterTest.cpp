@@ -0,0 +1,167 @@
+/*
+ *    This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host side test and benchmark of the group address check done before sending the ACK
+ *
+ * The address and association tables are filled the way KonnektingDevice reads them from memory
+ * (full size for the system type, association table not sorted, GAs with no or several associations),
+ * then the real KonnektingDevice::buildAssociationIndex()/buildAddressFilter() are run.
+ * On the whole GA space, KnxTpUart::isAddressAssigned() is cross-checked against a plain scan of the tables,
+ * with the address filter (constant time check) and without it (fallback to the tables search), and
+ * getAddressedComObjects() is checked to give every com object of the GA.
+ * Both checks are then timed.
+ *
+ * Build and run from this directory :
+ *   g++ -std=c++11 -O2 -D__AVR__ -I. -I../../src AddressFilterTest.cpp HostArduino.cpp ../../src/*.cpp -o AddressFilterTest && ./AddressFilterTest
+ */
+
+#include "KonnektingDevice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Sketch side definitions needed to link the library
+KnxComObject KnxDevice::_comObjectsList[] = {
+    /* 0 */ KnxComObject(KNX_DPT_1_001, KNX_COM_OBJ_C_W_U_T_INDICATOR),
+    /* 1 */ KnxComObject(KNX_DPT_1_001, KNX_COM_OBJ_C_W_U_T_INDICATOR),
+    /* 2 */ KnxComObject(KNX_DPT_9_001, KNX_COM_OBJ_C_R_T_INDICATOR),
+    /* 3 */ KnxComObject(KNX_DPT_5_001, KNX_COM_OBJ_C_W_U_T_INDICATOR)
+};
+const byte KnxDevice::_numberOfComObjects = sizeof (_comObjectsList) / sizeof (KnxComObject);
+byte KonnektingDevice::_paramSizeList[] = {
+    /* 0 */ PARAM_UINT8
+};
+const int KonnektingDevice::_numberOfParams = sizeof (_paramSizeList);
+void knxEvents(byte index) {}
+
+#define ADDRESSES_NB KONNEKTING_NUMBER_OF_ADDRESSES
+#define ASSOCIATIONS_NB KONNEKTING_NUMBER_OF_ASSOCIATIONS
+#define BENCH_ROUNDS 100
+
+static word addresses[ADDRESSES_NB];   // sorted, as written by the suite
+static byte assocGaId[ASSOCIATIONS_NB];
+static byte assocCoId[ASSOCIATIONS_NB];
+
+// Access to the library internals
+class KnxHostTest {
+  public:
+    // Load the tables and build the index and the filter, as KonnektingDevice::internalInit() does
+    static void loadTables(void) {
+        KonnektingDevice::_addressTable.size = ADDRESSES_NB;
+        KonnektingDevice::_addressTable.address = (word *)malloc(ADDRESSES_NB * sizeof(word));
+        memcpy(KonnektingDevice::_addressTable.address, addresses, sizeof(addresses));
+        KonnektingDevice::_associationTable.size = ASSOCIATIONS_NB;
+        KonnektingDevice::_associationTable.gaId = (byte *)malloc(ASSOCIATIONS_NB);
+        KonnektingDevice::_associationTable.coId = (byte *)malloc(ASSOCIATIONS_NB);
+        memcpy(KonnektingDevice::_associationTable.gaId, assocGaId, sizeof(assocGaId));
+        memcpy(KonnektingDevice::_associationTable.coId, assocCoId, sizeof(assocCoId));
+        Konnekting.buildAssociationIndex();
+        Konnekting.buildAddressFilter();
+    }
+    static void setFilterAvailable(boolean available) { KonnektingDevice::_addressFilter.available = available; }
+    static boolean isFilterAvailable(void) { return KonnektingDevice::_addressFilter.available; }
+    static boolean isAddressAssigned(KnxTpUart& tpuart, word addr) { return tpuart.isAddressAssigned(addr); }
+};
+
+// GAs spread over several main/middle groups, with gaps in the low bytes
+// Associations in no particular order, every 5th GA has none and the following one gets a second one
+static void fillTables(void) {
+    for (int i = 0; i < ADDRESSES_NB; i++) addresses[i] = G_ADDR(1 + i / 48, (i / 16) % 8, (byte)((i % 16) * 13 + 5));
+    for (int i = 0; i < ASSOCIATIONS_NB; i++) {
+        byte gaId = (byte)((i * 37) % ADDRESSES_NB);
+        if (!(gaId % 5)) gaId = (gaId + 1) % ADDRESSES_NB;
+        assocGaId[i] = gaId;
+        assocCoId[i] = (byte)(i % Knx.getNumberOfComObjects());
+    }
+}
+
+// Reference : plain scan of the tables, returns the nb of associations of the GA
+// and the sum of their com object ids (checked against the com objects list given by the TPUART)
+static int scanTables(word ga, int& coIdSum) {
+    int items = 0;
+    coIdSum = 0;
+    for (int i = 0; i < ASSOCIATIONS_NB; i++) {
+        if (addresses[assocGaId[i]] == ga) {
+            items++;
+            coIdSum += assocCoId[i];
+        }
+    }
+    return items;
+}
+
+// Time of the check on the whole GA space (ns per GA)
+static double benchIsAddressAssigned(KnxTpUart& tpuart, long& assigned) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    assigned = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (long ga = 0; ga <= 0xFFFF; ga++) assigned += KnxHostTest::isAddressAssigned(tpuart, (word)ga);
+    }
+    std::chrono::nanoseconds time = std::chrono::steady_clock::now() - start;
+    assigned /= BENCH_ROUNDS;
+    return (double)time.count() / (BENCH_ROUNDS * 65536.0);
+}
+
+int main() {
+    HardwareSerial serial;
+    KnxTpUart tpuart(serial, 0x1101, NORMAL);
+    long errors = 0, assigned = 0, filterAssigned, tablesAssigned;
+
+    // the TPUART needs a com objects list to check the addresses
+    static KnxComObject comObjects[] = { KnxComObject(KNX_DPT_1_001, KNX_COM_OBJ_C_W_U_T_INDICATOR) };
+    serial.inject(TPUART_RESET_INDICATION);
+    if ((tpuart.reset() != KNX_TPUART_OK) || (tpuart.attachComObjectsList(comObjects, 1) != KNX_TPUART_OK)) {
+        printf("TPUART init failed\nFAILED\n");
+        return 1;
+    }
+
+    fillTables();
+    KnxHostTest::loadTables();
+    if (!KnxHostTest::isFilterAvailable()) errors++;
+
+    // cross-check on the whole GA space, with and without the filter
+    for (long ga = 0; ga <= 0xFFFF; ga++) {
+        int coIdSum;
+        int items = scanTables((word)ga, coIdSum);
+        boolean expected = (items > 0) || (ga == 0x7fff);  // the programming GA is always assigned
+
+        KnxHostTest::setFilterAvailable(true);
+        if (KnxHostTest::isAddressAssigned(tpuart, (word)ga) != expected) errors++;
+        KnxHostTest::setFilterAvailable(false);
+        if (KnxHostTest::isAddressAssigned(tpuart, (word)ga) != expected) errors++;
+
+        if (ga != 0x7fff) {
+            AddressedComObjects comObjects = tpuart.getAddressedComObjects((word)ga);
+            int listSum = 0;
+            for (byte i = 0; i < comObjects.items; i++) listSum += comObjects.list[i];
+            if ((comObjects.items != items) || (listSum != coIdSum)) errors++;
+        }
+        if (expected) assigned++;
+    }
+    printf("cross-check : %d addresses, %d associations, %ld GAs assigned, %ld errors\n", ADDRESSES_NB, ASSOCIATIONS_NB, assigned, errors);
+
+    KnxHostTest::setFilterAvailable(true);
+    double filterTime = benchIsAddressAssigned(tpuart, filterAssigned);
+    KnxHostTest::setFilterAvailable(false);
+    double tablesTime = benchIsAddressAssigned(tpuart, tablesAssigned);
+    KnxHostTest::setFilterAvailable(true);
+    if ((filterAssigned != assigned) || (tablesAssigned != assigned)) errors++;
+    printf("isAddressAssigned() : %.2f ns per GA with the address filter, %.2f ns per GA with the tables search\n", filterTime, tablesTime);
+
+    printf("%s\n", errors ? "FAILED" : "OK");
+    return (errors ? 1 : 0);
+}
@@ -0,0 +1,120 @@
+/*
+ * Minimal Arduino definitions for the host side tests of the library
+ *
+ * Just enough of the core API to build the library sources (src/*.cpp) on a PC,
+ * the time and I/O functions are implemented in HostArduino.cpp
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define SERIAL_8E1 0x2A
+
+#include "avr/pgmspace.h"
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+// binary constants used by the library
+#define B00000000 0x00
+#define B00000001 0x01
+#define B00000010 0x02
+#define B00000100 0x04
+#define B00001000 0x08
+#define B00001010 0x0A
+#define B00001100 0x0C
+#define B00001111 0x0F
+#define B00010000 0x10
+#define B00010011 0x13
+#define B00100000 0x20
+#define B00110011 0x33
+#define B01010011 0x53
+#define B01110000 0x70
+#define B10000000 0x80
+#define B10111100 0xBC
+#define B11000000 0xC0
+#define B11011111 0xDF
+#define B11100001 0xE1
+
+template <class A, class B> inline auto min(A a, B b) -> decltype(a + b) { return (a < b) ? a : b; }
+template <class A, class B> inline auto max(A a, B b) -> decltype(a + b) { return (a > b) ? a : b; }
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+void noInterrupts(void);
+void interrupts(void);
+
+class String {
+  public:
+    String(const char* str = "") : _str(str) {}
+    String(char c) : _str(1, c) {}
+    String(unsigned long value, byte base = DEC) {
+        char buf[12];
+        snprintf(buf, sizeof(buf), (base == HEX) ? "%lx" : "%lu", value);
+        _str = buf;
+    }
+    String(int value, byte base = DEC) : String((unsigned long)value, base) {}
+    String(unsigned int value, byte base = DEC) : String((unsigned long)value, base) {}
+    String(byte value, byte base = DEC) : String((unsigned long)value, base) {}
+    String& operator+=(const String& rhs) { _str += rhs._str; return *this; }
+    String& operator+=(char c) { _str += c; return *this; }
+    friend String operator+(const String& lhs, const String& rhs) { String s(lhs); s += rhs; return s; }
+    unsigned int length(void) const { return _str.length(); }
+    const char* c_str(void) const { return _str.c_str(); }
+
+  private:
+    std::string _str;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    virtual int availableForWrite(void) { return 0; }
+    size_t print(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+    size_t print(const __FlashStringHelper* str) { return print((const char*)str); }
+    size_t println(const char* str) { return print(str) + print("\n"); }
+    size_t println(const __FlashStringHelper* str) { return println((const char*)str); }
+};
+
+class Stream : public Print {
+  public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) { return -1; }
+    virtual void flush(void) {}
+};
+
+#include "HardwareSerial.h"
+
+#endif // ARDUINO_H
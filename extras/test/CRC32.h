@@ -0,0 +1,27 @@
+/*
+ * Host side CRC32 for the tests of the library (same API as the Arduino CRC32 library)
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+class CRC32 {
+  public:
+    void reset(void) { _state = 0xFFFFFFFFUL; }
+    void update(uint8_t data) {
+        _state ^= data;
+        for (int i = 0; i < 8; i++) _state = (_state >> 1) ^ ((_state & 1) ? 0xEDB88320UL : 0);
+    }
+    template <typename T> void update(const T* data, int size) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (int i = 0; i < size * (int)sizeof(T); i++) update(bytes[i]);
+    }
+    uint32_t finalize(void) const { return ~_state; }
+
+  private:
+    uint32_t _state = 0xFFFFFFFFUL;
+};
+
+#endif // CRC32_H
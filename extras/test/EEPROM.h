@@ -0,0 +1,20 @@
+/*
+ * Host side EEPROM for the tests of the library (RAM backed, erased state 0xFF)
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include "Arduino.h"
+
+struct EEPROMClass {
+    uint8_t data[8192];
+    EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+    uint8_t read(int index) { return data[index]; }
+    void write(int index, uint8_t value) { data[index] = value; }
+    void update(int index, uint8_t value) { data[index] = value; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // EEPROM_H
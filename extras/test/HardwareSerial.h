@@ -0,0 +1,37 @@
+/*
+ * Host side HardwareSerial for the tests of the library
+ *
+ * The bytes given to inject() are read back by the library as received ones,
+ * the bytes written by the library are kept in txData
+ */
+
+#ifndef HARDWARESERIAL_H
+#define HARDWARESERIAL_H
+
+#include <deque>
+#include <vector>
+
+class HardwareSerial : public Stream {
+  public:
+    std::deque<uint8_t> rxData;
+    std::vector<uint8_t> txData;
+
+    void begin(unsigned long, uint8_t = 0) {}
+    void end(void) {}
+    void inject(uint8_t data) { rxData.push_back(data); }
+    int available(void) { return (int)rxData.size(); }
+    int read(void) {
+        if (rxData.empty()) return -1;
+        int data = rxData.front();
+        rxData.pop_front();
+        return data;
+    }
+    size_t write(uint8_t data) {
+        txData.push_back(data);
+        return 1;
+    }
+    using Print::write;
+    int availableForWrite(void) { return 64; }
+};
+
+#endif // HARDWARESERIAL_H
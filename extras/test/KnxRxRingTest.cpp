@@ -0,0 +1,206 @@
+/*
+ *    This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host side test of KnxRxRing and of the telegrams reception through it
+ *
+ * 1) overflow : the bytes pushed to a full ring are counted as lost
+ * 2) producer / consumer : a thread plays the UART RX interrupt and pushes a numbered byte stream as fast as
+ *    it can, the main thread pops it and checks that every byte and timestamp comes out once and in order
+ * 3) bus reception : a thread plays the UART RX interrupt at the bus speed (one byte every 573us, i.e. 11 bits
+ *    at 19200 baud) with real gaps between the frames, one frame being truncated. The main thread runs
+ *    KnxTpUart::rxTask() at an irregular period, late polls included, and checks the telegrams split out of the
+ *    stream : every complete frame is received once and unchanged, the truncated one is detected by timeout
+ *    (reception error) and is not merged with the frame that follows it
+ *
+ * Build and run from this directory :
+ *   g++ -std=c++11 -O2 -pthread -D__AVR__ -I. -I../../src KnxRxRingTest.cpp HostArduino.cpp ../../src/*.cpp -o KnxRxRingTest && ./KnxRxRingTest
+ */
+
+#include "KonnektingDevice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+// Sketch side definitions needed to link the library
+KnxComObject KnxDevice::_comObjectsList[] = {
+    /* 0 */ KnxComObject(KNX_DPT_1_001, KNX_COM_OBJ_C_W_U_T_INDICATOR)
+};
+const byte KnxDevice::_numberOfComObjects = sizeof (_comObjectsList) / sizeof (KnxComObject);
+byte KonnektingDevice::_paramSizeList[] = {
+    /* 0 */ PARAM_UINT8
+};
+const int KonnektingDevice::_numberOfParams = sizeof (_paramSizeList);
+void knxEvents(byte index) {}
+
+#define BYTE_TIME 573        // 11 bits at 19200 baud (usec)
+#define FRAME_GAP_MIN 2800   // gap between two frames on the bus (usec), 53 bit times at least
+#define FRAMES_NB 60
+#define TRUNCATED_FRAME 23   // index of the frame whose tail is lost
+#define TRUNCATED_LENGTH 9   // bytes of this frame sent on the bus (i.e. cut within the payload)
+
+static KnxRxRing ring;
+
+static int receptionErrors = 0;
+static void tpUartEvent(KnxTpUart&, KnxTpUartEvent event) {
+    if (event == TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR) receptionErrors++;
+}
+static void tpUartAck(KnxTpUart&, TpUartTxAck) {}
+
+// Busy wait till the given time (usec), the way the bytes come out of the UART
+static void waitUntil(unsigned long time) {
+    while ((long)(micros() - time) < 0) std::this_thread::yield();
+}
+
+// Group value write from 1.1.<index> to the programming group address, 1 to 9 payload bytes
+static void buildFrame(int index, std::vector<byte>& frame) {
+    KnxTelegram telegram;
+    byte payload[8];
+    byte payloadLength = 1 + (index % 9);
+
+    telegram.setSourceAddress(0x1100 + index);
+    telegram.setTargetAddress(0x7fff);
+    telegram.setCommand(KNX_COMMAND_VALUE_WRITE);
+    telegram.setPayloadLength(payloadLength);
+    telegram.setFirstPayloadByte(index & 0x3F);
+    for (byte i = 0; i < sizeof(payload); i++) payload[i] = (byte)(index * 7 + i);
+    if (payloadLength > 1) telegram.setLongPayload(payload, payloadLength - 1);
+    telegram.updateChecksum();
+    frame.clear();
+    for (word i = 0; i < telegram.getTelegramLength(); i++) frame.push_back(telegram.readRawByte(i));
+}
+
+static boolean sameFrame(const KnxTelegram& telegram, const std::vector<byte>& frame) {
+    if (telegram.getTelegramLength() != frame.size()) return false;
+    for (word i = 0; i < frame.size(); i++) {
+        if (telegram.readRawByte(i) != frame[i]) return false;
+    }
+    return true;
+}
+
+// Run the bus reception once
+// return the nb of errors found, -1 if the producer thread has been held up (the run is not meaningful then)
+static int busReception(void) {
+    HardwareSerial serial;
+    KnxTpUart tpuart(serial, 0x1001, NORMAL);
+    std::vector<std::vector<byte> > frames(FRAMES_NB);
+    unsigned long worstByteGap = 0;
+    volatile boolean producerDone = false;
+    int errors = 0, received = 0, nextFrame = 0, polls = 0;
+    KnxTelegram* telegram;
+
+    for (int i = 0; i < FRAMES_NB; i++) buildFrame(i, frames[i]);
+    receptionErrors = 0;
+
+    // the ring is attached before the reset, the reset indication comes through it
+    tpuart.attachRxRing(&ring);
+    ring.push(TPUART_RESET_INDICATION);
+    if (tpuart.reset() != KNX_TPUART_OK) return 1;
+    tpuart.setEvtCallback(&tpUartEvent);
+    tpuart.setAckCallback(&tpUartAck);
+    if (tpuart.init() != KNX_TPUART_OK) return 1;
+
+    std::thread producer([&] {
+        unsigned long byteTime = micros(), pushTime = 0;
+        for (int i = 0; i < FRAMES_NB; i++) {
+            int length = (i == TRUNCATED_FRAME) ? TRUNCATED_LENGTH : (int)frames[i].size();
+            for (int j = 0; j < length; j++) {
+                waitUntil(byteTime);
+                if (j && (micros() - pushTime > worstByteGap)) worstByteGap = micros() - pushTime;
+                pushTime = micros();
+                ring.push(frames[i][j]);  // timestamped with micros(), as in the UART RX interrupt
+                byteTime += BYTE_TIME;
+            }
+            byteTime += FRAME_GAP_MIN + (rand() % 2000);
+        }
+        producerDone = true;
+    });
+
+    // the consumer polls at an irregular period, from about once per byte to late polls several frames long
+    unsigned long endTime = 0;
+    while (!producerDone || ring.available() || (micros() - endTime < 2 * KNX_RECEPTION_TIMEOUT)) {
+        if (!producerDone || ring.available()) endTime = micros();
+        tpuart.rxTask();
+        polls++;
+        while ((telegram = tpuart.takeReceivedTelegram()) != NULL) {
+            if (nextFrame == TRUNCATED_FRAME) nextFrame++;
+            if ((nextFrame >= FRAMES_NB) || !sameFrame(*telegram, frames[nextFrame])) errors++;
+            nextFrame++;
+            received++;
+            tpuart.releaseReceivedTelegram(telegram);
+        }
+        int wait = rand() % 100;
+        delayMicroseconds((wait < 90) ? (wait * 20) : ((wait < 98) ? 5000 : 12000));
+    }
+    producer.join();
+
+    // a late byte (thread held up) may open a gap in a frame that the reception would rightly see as an EOP
+    if (worstByteGap > KNX_RECEPTION_TIMEOUT - BYTE_TIME / 2) {
+        printf("bus reception : producer held up, %luus gap within a frame, run discarded\n", worstByteGap);
+        return -1;
+    }
+    if (received != FRAMES_NB - 1) errors++;
+    if (receptionErrors != 1) errors++;
+    if (ring.getOverflowCount() != 10) errors++;  // none more than in the overflow test
+    printf("bus reception : %d frames, %d received, %d reception error(s), %d polls, worst gap within a frame %luus, %d errors\n",
+           FRAMES_NB, received, receptionErrors, polls, worstByteGap, errors);
+    return errors;
+}
+
+int main() {
+    const long bytesNb = 200000;
+    long received = 0, errors = 0;
+    byte data;
+    word timestamp;
+
+    // overflow : the ring keeps KNX_RX_RING_SIZE - 1 bytes, the further ones are counted as lost
+    for (int i = 0; i < KNX_RX_RING_SIZE + 9; i++) ring.push((byte)i, 0);
+    if ((ring.available() != KNX_RX_RING_SIZE - 1) || (ring.getOverflowCount() != 10)) errors++;
+    for (int i = 0; i < KNX_RX_RING_SIZE - 1; i++) {
+        if (!ring.pop(data, timestamp) || (data != (byte)i)) errors++;
+    }
+    if (ring.pop(data, timestamp)) errors++;
+    printf("overflow : %d bytes lost, %ld errors\n", ring.getOverflowCount(), errors);
+
+    // concurrent producer and consumer, the producer waits for a free slot so that no byte is lost
+    std::thread producer([bytesNb] {
+        for (long i = 0; i < bytesNb; i++) {
+            while (ring.available() == KNX_RX_RING_SIZE - 1) std::this_thread::yield();
+            ring.push((byte)i, (word)(i * 7));
+        }
+    });
+    while (received < bytesNb) {
+        if (!ring.pop(data, timestamp)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if ((data != (byte)received) || (timestamp != (word)(received * 7))) errors++;
+        received++;
+    }
+    producer.join();
+    if (ring.available() || (ring.getOverflowCount() != 10)) errors++;
+    printf("producer/consumer : %ld bytes, %ld errors\n", received, errors);
+
+    // bus reception through KnxTpUart::rxTask(), run again if the producer thread has been held up by the host
+    int busErrors = -1;
+    for (int attempt = 0; (attempt < 20) && (busErrors < 0); attempt++) busErrors = busReception();
+    if (busErrors) errors++;
+
+    printf("%s\n", errors ? "FAILED" : "OK");
+    return (errors ? 1 : 0);
+}
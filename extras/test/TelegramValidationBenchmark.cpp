@@ -0,0 +1,158 @@
+/*
+ *    This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Host side benchmark of the validation of a received telegram at End Of Packet
+ *
+ * Random standard frames (1 in 4 with one bit flipped) are received byte per byte as in KnxTpUart::rxTask().
+ * For each frame, the time from its last byte to the verdict is measured :
+ * - streaming validation (KnxTelegramValidator, as done by the TPUART) : the last byte is folded in, then getValidity()
+ * - validation at EOP (KnxTelegram::getValidity(), the former path) : the whole frame is XORed and checked again
+ * Each frame is timed on its own, right after its last byte, so that no verdict can be computed ahead of time
+ * or shared between frames. The timer overhead is measured the same way and taken off, and the best time of
+ * each frame over the rounds is kept (host scheduling noise).
+ * Both verdicts are cross-checked on every frame.
+ *
+ * Build and run from this directory :
+ *   g++ -std=c++11 -O2 -D__AVR__ -I. -I../../src TelegramValidationBenchmark.cpp HostArduino.cpp ../../src/*.cpp -o TelegramValidationBenchmark && ./TelegramValidationBenchmark
+ */
+
+#include "KonnektingDevice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Sketch side definitions needed to link the library
+KnxComObject KnxDevice::_comObjectsList[] = {
+    /* 0 */ KnxComObject(KNX_DPT_1_001, KNX_COM_OBJ_C_W_U_T_INDICATOR)
+};
+const byte KnxDevice::_numberOfComObjects = sizeof (_comObjectsList) / sizeof (KnxComObject);
+byte KonnektingDevice::_paramSizeList[] = {
+    /* 0 */ PARAM_UINT8
+};
+const int KonnektingDevice::_numberOfParams = sizeof (_paramSizeList);
+void knxEvents(byte index) {}
+
+#define FRAMES_NB 1024
+#define ROUNDS_NB 200
+
+// keeps the compiler from moving code across the timer reads
+#define BENCH_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+typedef std::chrono::steady_clock BenchClock;
+
+static KnxTelegram frames[FRAMES_NB];
+static long streamTime[FRAMES_NB], eopTime[FRAMES_NB], timerTime[FRAMES_NB];  // best time per frame (ns)
+
+static void buildFrames(void) {
+    srand(1);
+    for (int i = 0; i < FRAMES_NB; i++) {
+        KnxTelegram& telegram = frames[i];
+        telegram.clearTelegram();
+        telegram.setSourceAddress(P_ADDR(1, 1, 1 + rand() % 254));
+        telegram.setTargetAddress(G_ADDR(rand() % 16, rand() % 8, rand() % 256));
+        telegram.setCommand((rand() % 2) ? KNX_COMMAND_VALUE_WRITE : KNX_COMMAND_VALUE_RESPONSE);
+        telegram.setPayloadLength(1 + rand() % (KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1));
+        for (word j = KNX_TELEGRAM_HEADER_SIZE + 2; j < telegram.getTelegramLength() - 1; j++) telegram.writeRawByte(rand() % 256, j);
+        telegram.updateChecksum();
+        if ((i & 3) == 3) {
+            // corrupted frame : one bit flipped
+            word index = rand() % telegram.getTelegramLength();
+            telegram.writeRawByte(telegram.readRawByte(index) ^ (1 << (rand() % 8)), index);
+        }
+    }
+}
+
+static void keepBest(long& best, BenchClock::time_point start, BenchClock::time_point end) {
+    long time = (long)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    if ((best < 0) || (time < best)) best = time;
+}
+
+int main() {
+    KnxTelegramValidator validator;
+    KnxTelegram received;
+    double streamSum = 0, eopSum = 0, timerSum = 0;
+    long mismatches = 0, invalid = 0;
+    volatile int sink = 0;
+
+    buildFrames();
+    for (int i = 0; i < FRAMES_NB; i++) streamTime[i] = eopTime[i] = timerTime[i] = -1;
+
+    for (int round = 0; round < ROUNDS_NB; round++) {
+        for (int i = 0; i < FRAMES_NB; i++) {
+            const KnxTelegram& frame = frames[i];
+            word last = frame.getTelegramLength() - 1;
+            e_KnxTelegramValidity streamValidity, eopValidity;
+            BenchClock::time_point t0, t1;
+
+            // all the bytes but the last one are received, as in rxTask()
+            validator.start();
+            for (word j = 0; j < last; j++) {
+                received.writeRawByte(frame.readRawByte(j), j);
+                validator.addByte(frame.readRawByte(j), j);
+            }
+            received.writeRawByte(frame.readRawByte(last), last);
+
+            // timer overhead
+            BENCH_BARRIER();
+            t0 = BenchClock::now();
+            BENCH_BARRIER();
+            t1 = BenchClock::now();
+            BENCH_BARRIER();
+            keepBest(timerTime[i], t0, t1);
+
+            // streaming validation : last byte folded in, verdict
+            t0 = BenchClock::now();
+            BENCH_BARRIER();
+            validator.addByte(frame.readRawByte(last), last);
+            streamValidity = validator.getValidity();
+            sink = streamValidity;
+            BENCH_BARRIER();
+            t1 = BenchClock::now();
+            keepBest(streamTime[i], t0, t1);
+
+            // validation at EOP : the whole received frame is checked
+            BENCH_BARRIER();
+            t0 = BenchClock::now();
+            BENCH_BARRIER();
+            eopValidity = received.getValidity();
+            sink = eopValidity;
+            BENCH_BARRIER();
+            t1 = BenchClock::now();
+            keepBest(eopTime[i], t0, t1);
+
+            if (round == 0) {
+                if (streamValidity != eopValidity) mismatches++;
+                if (eopValidity != KNX_TELEGRAM_VALID) invalid++;
+            }
+        }
+    }
+    (void)sink;
+
+    for (int i = 0; i < FRAMES_NB; i++) {
+        timerSum += timerTime[i];
+        streamSum += streamTime[i] - timerTime[i];
+        eopSum += eopTime[i] - timerTime[i];
+    }
+    printf("frames : %d, invalid : %ld, verdict mismatches : %ld\n", FRAMES_NB, invalid, mismatches);
+    printf("time from the last byte to the verdict (timer overhead of %.1f ns taken off) :\n", timerSum / FRAMES_NB);
+    printf("  streaming validation (KnxTelegramValidator) : %.1f ns per frame\n", streamSum / FRAMES_NB);
+    printf("  validation at EOP (KnxTelegram::getValidity()) : %.1f ns per frame\n", eopSum / FRAMES_NB);
+
+    printf("%s\n", mismatches ? "FAILED" : "OK");
+    return (mismatches ? 1 : 0);
+}
@@ -0,0 +1,15 @@
+/*
+ * Host side program memory access for the tests of the library (flash is plain RAM)
+ */
+
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define vsnprintf_P vsnprintf
+
+#endif // PGMSPACE_H
@@ -0,0 +1,3 @@
+/*
+ * Host side stand-in for the Arduino core private header (nothing needed)
+ */
@@ -0,0 +1,124 @@
+/*!
+ * @file KnxBusMonitor.cpp
+ *
+ * @section author Author
+ *
+ * Written by Alexander Christian.
+ *
+ * @section license License
+ *
+ *    Copyright (C) 2016 Alexander Christian <info(at)root1.de>. All rights
+ *    reserved. This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "KnxBusMonitor.h"
+
+static inline word TimeDeltaWord(word now, word before) {
+    return (word)(now - before);
+}
+
+// Constructor
+KnxBusMonitor::KnxBusMonitor(KnxTpUart& tpuart)
+    : _tpuart(tpuart) {
+    _state = BUSMONITOR_IDLE;
+    _expectedLength = 0;
+    _xorSum = 0;
+    _lostFramesNb = 0;
+}
+
+/**
+ * Assembler task
+ * All the pending bus data are got from the TPUART (within the KNX_RX_BUDGET_BYTES limit) :
+ * - the 1st byte starts a new frame, the frame length is given by the routing field (6th byte),
+ *   or by the length byte (7th byte) of an extended frame
+ * - the frame is complete on its checksum byte, then the next byte is stored as acknowledge char if it is one
+ * - an End Of Packet closes the frame in any case (truncated frame or no acknowledge char)
+ */
+void KnxBusMonitor::task(void) {
+    MonitorData data;
+    byte budget = KNX_RX_BUDGET_BYTES;
+
+    while (budget-- && _tpuart.getMonitoringData(data)) {
+        if (data.isEOP) {
+            if (_state != BUSMONITOR_IDLE) storeFrame();
+            continue;
+        }
+
+        // acknowledge char following a complete frame
+        if (_state == BUSMONITOR_WAITING_ACK) {
+            if ((data.dataByte & KNX_ACK_CHAR_PATTERN_MASK) == KNX_ACK_CHAR_VALID_PATTERN) {
+                _frame.ackByte = data.dataByte;
+                storeFrame();
+                continue;
+            }
+            storeFrame();  // no acknowledge char, the byte starts a new frame
+        }
+
+        if (_state == BUSMONITOR_IDLE) {  // new frame
+            // the 32 bits start time is rebuilt from the 16 bits byte reception time
+            _frame.startTime = micros();
+            _frame.startTime -= TimeDeltaWord((word)_frame.startTime, data.timestamp);
+            _frame.length = 0;
+            _frame.ackByte = KNX_BUSMONITOR_NO_ACK;
+            _expectedLength = 0;
+            _xorSum = 0;
+            _state = BUSMONITOR_RECEPTION;
+        }
+
+        if (_frame.length < KNX_BUSMONITOR_FRAME_MAX_SIZE) _frame.data[_frame.length] = data.dataByte;
+        if (_frame.length < 0xFFFF) _frame.length++;
+        _xorSum ^= data.dataByte;
+
+        if ((_frame.data[0] & CONTROL_FIELD_FRAME_FORMAT_MASK) == CONTROL_FIELD_EXTENDED_FRAME_FORMAT) {
+            if (_frame.length == KNX_EXTENDED_TELEGRAM_HEADER_SIZE) {  // length byte (+ 1 for the length byte itself)
+                _expectedLength = data.dataByte + KNX_TELEGRAM_LENGTH_OFFSET + 1;
+            }
+        } else if (_frame.length == KNX_TELEGRAM_HEADER_SIZE) {  // routing field
+            _expectedLength = (data.dataByte & ROUTING_FIELD_PAYLOAD_LENGTH_MASK) + KNX_TELEGRAM_LENGTH_OFFSET;
+        }
+        if (_frame.length == _expectedLength) {  // checksum byte
+            _state = BUSMONITOR_WAITING_ACK;
+        }
+    }
+}
+
+/**
+ * Copy up to max assembled frames (oldest first) in records, and remove them from the ring
+ * 
+ * @param records array of at least max frame records
+ * @param max max nb of frames to copy
+ * @return the nb of copied frames
+ */
+byte KnxBusMonitor::drain(KnxBusMonitorFrame records[], byte max) {
+    byte nb = 0;
+    while ((nb < max) && _frames.pop(records[nb])) nb++;
+    return nb;
+}
+
+/**
+ * Store the assembled frame in the ring (the oldest frame is overwritten if the ring is full)
+ */
+void KnxBusMonitor::storeFrame(void) {
+    // the checksum is correct if the XOR sum of all the bytes (checksum included) is 0xFF
+    _frame.checksumOk = (_state == BUSMONITOR_WAITING_ACK) && (_xorSum == 0xFF);
+    if (_frames.getItemCount() == KNX_BUSMONITOR_RING_SIZE) {
+        if (_lostFramesNb < 0xFFFF) _lostFramesNb++;
+    }
+    _frames.append(_frame);
+    _state = BUSMONITOR_IDLE;
+}
@@ -0,0 +1,109 @@
+/*
+ *    This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KNXBUSMONITOR_H
+#define KNXBUSMONITOR_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxTpUart.h"
+#include "RingBuff.h"
+
+// Nb of frame records kept until they are drained
+#ifndef KNX_BUSMONITOR_RING_SIZE
+#define KNX_BUSMONITOR_RING_SIZE 8
+#endif
+
+// Max nb of bytes stored per frame record (longer frames are truncated, their length is still the full one)
+// The default fits the standard frames, it can be raised up to KNX_EXTENDED_TELEGRAM_MAX_SIZE to store the long extended frames
+#ifndef KNX_BUSMONITOR_FRAME_MAX_SIZE
+#define KNX_BUSMONITOR_FRAME_MAX_SIZE KNX_TELEGRAM_MAX_SIZE
+#endif
+
+// Acknowledge chars sent on the bus after a frame
+#define KNX_ACK_CHAR_PATTERN_MASK   B00110011 // 0x33
+#define KNX_ACK_CHAR_VALID_PATTERN  B00000000
+#define KNX_ACK_CHAR_ACK            0xCC
+#define KNX_ACK_CHAR_NACK           0x0C
+#define KNX_ACK_CHAR_BUSY           0xC0
+#define KNX_ACK_CHAR_NACK_BUSY      0x00
+#define KNX_BUSMONITOR_NO_ACK       0xFF // no acknowledge char received after the frame
+
+// Frame record
+typedef struct KnxBusMonitorFrame {
+  unsigned long startTime;          // Reception time (in usec, micros() base) of the first byte
+  word length;                      // Nb of bytes of the frame (only the first KNX_BUSMONITOR_FRAME_MAX_SIZE bytes are stored)
+  byte data[KNX_BUSMONITOR_FRAME_MAX_SIZE]; // Raw frame bytes
+  boolean checksumOk;               // True if the frame is complete and its checksum is correct
+  byte ackByte;                     // Acknowledge char following the frame (KNX_BUSMONITOR_NO_ACK if none)
+} KnxBusMonitorFrame;
+
+// Assembler states
+enum KnxBusMonitorState {
+  BUSMONITOR_IDLE,          // Waiting for a frame
+  BUSMONITOR_RECEPTION,     // Frame reception ongoing
+  BUSMONITOR_WAITING_ACK    // Frame complete, waiting for the acknowledge char
+};
+
+/**
+ * Bus monitor frame assembler
+ * 
+ * Gets the bus data from a TPUART in BUS_MONITOR mode (see KnxTpUart::getMonitoringData()) and assembles 
+ * complete frame records (start time, raw bytes, checksum verdict, acknowledge char) in a preallocated ring.
+ * The frames are closed on their checksum byte (length given by the routing field, or by the length byte
+ * of an extended frame) or on End Of Packet.
+ * The records are got in bulk with drain(), so that there's no per byte processing in the application.
+ */
+class KnxBusMonitor {
+    KnxTpUart& _tpuart;                                         // TPUART in BUS_MONITOR mode
+    KnxBusMonitorState _state;                                  // Current assembler state
+    KnxBusMonitorFrame _frame;                                  // Frame being assembled
+    word _expectedLength;                                       // Length of the frame being assembled (0 if not known yet)
+    byte _xorSum;                                               // XOR sum of the bytes of the frame being assembled
+    RingBuff<KnxBusMonitorFrame, KNX_BUSMONITOR_RING_SIZE> _frames; // Assembled frames, waiting to be drained
+    word _lostFramesNb;                                         // Nb of frames overwritten before being drained
+
+  public:
+    // Constructor
+    // The TPUART shall be created in BUS_MONITOR mode, reset and initialized by the application
+    KnxBusMonitor(KnxTpUart& tpuart);
+
+    // Assembler task
+    // Gets all the pending bus data (within the KNX_RX_BUDGET_BYTES limit) and assembles the frames
+    // This function shall be called periodically (max period of 0,5ms when no RX ring is attached to the TPUART)
+    void task(void);
+
+    // Copy up to max assembled frames (oldest first) in records, and remove them from the ring
+    // return the nb of copied frames
+    byte drain(KnxBusMonitorFrame records[], byte max);
+
+    // Nb of assembled frames waiting to be drained
+    byte available(void) const;
+
+    // Nb of frames lost because the ring was full (saturated at 65535)
+    word getLostFramesNb(void) const;
+
+  private:
+    // Store the assembled frame in the ring
+    void storeFrame(void);
+};
+
+inline byte KnxBusMonitor::available(void) const { return _frames.getItemCount(); }
+
+inline word KnxBusMonitor::getLostFramesNb(void) const { return _lostFramesNb; }
+
+#endif // KNXBUSMONITOR_H
@@ -43,13 +43,19 @@ byte calcLength(KnxDpt dptId) {
     return (pgm_read_byte(&KnxDptFormatToLength[ pgm_read_byte(&KnxDptToFormat[dptId])]) / 8) + 1;
 }
 
+// Values of the com objects, zero initialized at startup
+byte KnxComObject::_valueArenaStatic[KNX_COMOBJ_VALUE_ARENA_SIZE];
+byte* KnxComObject::_valueArena = NULL;
+word KnxComObject::_valueArenaUsed = 0;
+
 /**
  * Contructor
  * @param dptId
  * @param indicator
+ * @param priority KNX priority of the sent telegrams (NORMAL by default)
  */
-KnxComObject::KnxComObject(KnxDpt dptId, byte indicator)
-: _dptId(dptId), _indicator(indicator), _dataLength(calcLength(dptId)) {
+KnxComObject::KnxComObject(KnxDpt dptId, byte indicator, e_KnxPriority priority)
+: _dptId(dptId), _indicator(indicator), _dataLength(calcLength(dptId)), _priority(priority), _pendingTxSlot(255) {
         
     if (_indicator & KNX_COM_OBJ_I_INDICATOR) {
         // Object with "InitRead" indicator
@@ -58,26 +64,27 @@ KnxComObject::KnxComObject(KnxDpt dptId, byte indicator)
         // any other typed object
         _validated = true; 
     }
-    
-    if (_dataLength <= 2) {
-        _longValue = NULL; 
-    } else { 
-        // long value case
-        _longValue = (byte *) malloc(_dataLength - 1);
-        for (byte i = 0; i < _dataLength - 1; i++) {
-            _longValue[i] = 0;
-        }
-    }
-    
+
+    // The value is placed by KnxDevice (see reserveValue())
+    _valueOffset = KNX_COMOBJ_NO_VALUE;
 }
 
 /**
- * Destructor
+ * Reserve the place of the value in the arena, right after the previous reserved one
  */
-KnxComObject::~KnxComObject() {
-    if (_dataLength > 2) {
-        free(_longValue);
-    }
+void KnxComObject::reserveValue(void) {
+    _valueOffset = _valueArenaUsed;
+    _valueArenaUsed += getValueWidth();
+}
+
+/**
+ * Allocate the arena of the reserved values, the static one if they fit in it
+ * A larger table gets a single zero initialized heap block, so that no com object table is refused
+ */
+bool KnxComObject::allocValueArena(void) {
+    if (_valueArenaUsed <= KNX_COMOBJ_VALUE_ARENA_SIZE) _valueArena = _valueArenaStatic;
+    else _valueArena = (byte*)calloc(_valueArenaUsed, 1);
+    return (_valueArena != NULL);
 }
 
 /**
@@ -94,12 +101,13 @@ bool KnxComObject::isActive() {
  * @param value
  */
 void KnxComObject::getValue(byte value[]) const {
-    if (_dataLength <= 2) {
-        value[0] = _value; // short value case, ReadValue(void) fct should rather be used
-    } else {
-        for (byte i = 0; i < _dataLength - 1; i++) {
-            value[i] = _longValue[i]; // long value case
-        }
+    if (!hasValue()) {
+        memset(value, 0, getValueWidth());
+        return;
+    }
+    const byte* ori = getValuePtr();
+    for (byte i = 0; i < getValueWidth(); i++) {
+        value[i] = ori[i];
     }
 }
 
@@ -108,12 +116,10 @@ void KnxComObject::getValue(byte value[]) const {
  * @param other
  */
 void KnxComObject::updateValue(const byte other[]) {
-    if (_dataLength <= 2) {
-        _value = other[0]; // short value case, UpdateValue(byte) fct should rather be used
-    } else {
-        for (byte i = 0; i < _dataLength - 1; i++) {
-            _longValue[i] = other[i]; // long value case
-        }
+    if (!hasValue()) return;
+    byte* dest = getValuePtr();
+    for (byte i = 0; i < getValueWidth(); i++) {
+        dest[i] = other[i];
     }
     _validated = true; 
 }
@@ -128,17 +134,13 @@ byte KnxComObject::updateValue(const KnxTelegram& other) {
     if (other.getPayloadLength() != getLength()) {
         return KNX_COM_OBJECT_ERROR; // Error : telegram payload length differs from com obj one
     }
+    if (!hasValue()) return KNX_COM_OBJECT_ERROR;
     
-    switch (_dataLength) {
-        case 1:
-            _value = other.getFirstPayloadByte();
-            break;
-        case 2:
-            other.getLongPayload(&_value, 1);
-            break;
-        default:
-            other.getLongPayload(_longValue, _dataLength - 1);
-    }    
+    if (_dataLength == 1) {
+        *getValuePtr() = other.getFirstPayloadByte();
+    } else {
+        other.getLongPayload(getValuePtr(), _dataLength - 1);
+    }
     
     _validated = true; // com object set to valid
     return KNX_COM_OBJECT_OK;
@@ -159,14 +161,16 @@ void KnxComObject::copyAttributes(KnxTelegram& dest) const {
  * @param dest
  */
 void KnxComObject::copyValue(KnxTelegram& dest) const {
-    switch (_dataLength) {
-        case 1:
-            dest.setFirstPayloadByte(_value);
-            break;
-        case 2:
-            dest.setLongPayload(&_value, 1);
-            break;
-        default:
-            dest.setLongPayload(_longValue, _dataLength - 1);
-    }    
+    if (!hasValue()) {
+        // no value (not placed in the arena) : 0 is sent
+        byte zero[KNX_TELEGRAM_PAYLOAD_MAX_SIZE] = {0};
+        if (_dataLength == 1) dest.setFirstPayloadByte(0);
+        else dest.setLongPayload(zero, _dataLength - 1);
+        return;
+    }
+    if (_dataLength == 1) {
+        dest.setFirstPayloadByte(*getValuePtr());
+    } else {
+        dest.setLongPayload(getValuePtr(), _dataLength - 1);
+    }
 }
\ No newline at end of file
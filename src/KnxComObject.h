@@ -55,6 +55,20 @@
 #define KNX_COM_OBJECT_OK 0
 #define KNX_COM_OBJECT_ERROR 255
 
+// Size (in bytes) of the static arena holding the values of all the com objects, the programming one included (14 bytes)
+// Each com object of the table takes the width of its value (1 byte for the short values),
+// a table needing more gets its values in a single heap block of the needed size instead
+#ifndef KNX_COMOBJ_VALUE_ARENA_SIZE
+#define KNX_COMOBJ_VALUE_ARENA_SIZE 128
+#endif
+
+#if KNX_COMOBJ_VALUE_ARENA_SIZE < 14
+#error "KNX_COMOBJ_VALUE_ARENA_SIZE shall hold at least the programming com object value (14 bytes)"
+#endif
+
+// Value offset of a com object which has no place in the arena yet
+#define KNX_COMOBJ_NO_VALUE 0xFFFF
+
 class KnxComObject {
 
     // set to active if GA has been set
@@ -88,23 +102,56 @@ class KnxComObject {
      */
     bool _validated;
 
-    union {
-        // field used in case of short value (1 byte max width, i.e. length <= 2)
-        struct {
-            byte _value;
-            byte _notUSed;
-        };
-        // field used in case of long value (2 bytes width or more, i.e. length > 2)
-        // The data space is allocated dynamically by the constructor
-        byte* _longValue;
-    };
+    /**
+     * KNX priority of the telegrams sent for the com object
+     */
+    e_KnxPriority _priority;
+
+    /**
+     * Slot of the pending WRITE action in the TX queue (255 if none), used for the TX coalescing
+     */
+    byte _pendingTxSlot;
+
+    /**
+     * Offset of the value in the arena, for short (length <= 2) and long values alike
+     * KNX_COMOBJ_NO_VALUE till the space is reserved (see reserveValue()) : the value then reads 0 and can't be updated
+     */
+    word _valueOffset;
+
+    /**
+     * Values of the com objects : the static arena, or a heap block when the static one is too small
+     * (NULL till allocValueArena()), and nb of bytes reserved
+     */
+    static byte _valueArenaStatic[KNX_COMOBJ_VALUE_ARENA_SIZE];
+    static byte* _valueArena;
+    static word _valueArenaUsed;
 
    public:
     // Constructor :
-    KnxComObject(KnxDpt dptId, byte indicator);
+    KnxComObject(KnxDpt dptId, byte indicator, e_KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE);
+
+    /**
+     * Nb of bytes of the value arena needed by the com objects reserved so far
+     */
+    static word getValueArenaUsed(void);
+
+    /**
+     * Reserve the place of the value right after the previous reserved one
+     * Called once by KnxDevice for the programming com object and the com object table, before allocValueArena(),
+     * so that the copies and temporary com objects take no place
+     */
+    void reserveValue(void);
 
-    // Destructor
-    ~KnxComObject();
+    /**
+     * Allocate the arena of the reserved values : the static one if they fit in it, else a heap block of their size
+     * Returns false if there's no memory for the heap block (the com objects then have no value)
+     */
+    static bool allocValueArena(void);
+
+    /**
+     * True once the value arena has been allocated
+     */
+    static bool isValueArenaAllocated(void);
 
     bool isActive(void);
 
@@ -124,6 +171,12 @@ class KnxComObject {
 
     e_KnxPriority getPriority(void) const;
 
+    void setPriority(e_KnxPriority);
+
+    byte getPendingTxSlot(void) const;
+
+    void setPendingTxSlot(byte);
+
     byte getIndicator(void) const;
 
     bool getValidity(void) const;
@@ -182,6 +235,16 @@ class KnxComObject {
      * @param dest
      */
     void copyValue(KnxTelegram& dest) const;
+
+  private:
+    // Width (in bytes) of the value : 1 for the short values, length - 1 for the long ones
+    byte getValueWidth(void) const;
+
+    // True if the value has a place in the arena
+    bool hasValue(void) const;
+
+    // Location of the value in the arena (to be used only if hasValue())
+    byte* getValuePtr(void) const;
 };
 
 // --------------- Definition of the INLINE functions -----------------
@@ -204,7 +267,19 @@ inline byte KnxComObject::getDptId(void) const {
 }
 
 inline e_KnxPriority KnxComObject::getPriority(void) const {
-    return KNX_PRIORITY_NORMAL_VALUE;
+    return _priority;
+}
+
+inline void KnxComObject::setPriority(e_KnxPriority priority) {
+    _priority = priority;
+}
+
+inline byte KnxComObject::getPendingTxSlot(void) const {
+    return _pendingTxSlot;
+}
+
+inline void KnxComObject::setPendingTxSlot(byte slot) {
+    _pendingTxSlot = slot;
 }
 
 inline byte KnxComObject::getIndicator(void) const {
@@ -223,19 +298,41 @@ inline byte KnxComObject::getLength(void) const {
     return _dataLength;
 }
 
+inline word KnxComObject::getValueArenaUsed(void) {
+    return _valueArenaUsed;
+}
+
+inline byte KnxComObject::getValueWidth(void) const {
+    return (_dataLength > 2 ? _dataLength - 1 : 1);
+}
+
+inline bool KnxComObject::isValueArenaAllocated(void) {
+    return (_valueArena != NULL);
+}
+
+inline bool KnxComObject::hasValue(void) const {
+    return (_valueArena && (_valueOffset != KNX_COMOBJ_NO_VALUE));
+}
+
+inline byte* KnxComObject::getValuePtr(void) const {
+    return _valueArena + _valueOffset;
+}
+
 inline byte KnxComObject::getValue(void) const {
-    return _value;
+    return (hasValue() ? *getValuePtr() : 0);
 }
 
 inline byte KnxComObject::updateValue(byte newValue) {
-    if (_dataLength > 2) return KNX_COM_OBJECT_ERROR;
-    _value = newValue;
+    if ((_dataLength > 2) || !hasValue()) return KNX_COM_OBJECT_ERROR;
+    *getValuePtr() = newValue;
     _validated = true;
     return KNX_COM_OBJECT_OK;
 }
 
 inline void KnxComObject::toggleValue(void) {
-    _value = !_value;
+    if (!hasValue()) return;
+    byte* value = getValuePtr();
+    *value = !*value;
 }
 
 #endif  // KNXCOMOBJECT_H
@@ -32,6 +32,21 @@ static inline word TimeDeltaWord(word now, word before) {
     return (word)(now - before);
 }
 
+// Build the event of a value received for a com object
+static KnxEvent receivedEvent(const KnxTelegram& telegram, byte index, const KnxComObject& comObj) {
+    KnxEvent event;
+    byte length = comObj.getLength();
+
+    event.index = index;
+    event.command = telegram.getCommand();
+    event.hasValue = (telegram.getPayloadLength() == length);
+    if (event.hasValue) {
+        if (length == 1) event.value[0] = telegram.getFirstPayloadByte();
+        else telegram.getLongPayload(event.value, length - 1);
+    }
+    return event;
+}
+
 // KnxDevice unique instance creation
 KnxDevice KnxDevice::Knx;
 KnxDevice& Knx = KnxDevice::Knx;
@@ -40,11 +55,31 @@ KnxDevice& Knx = KnxDevice::Knx;
 
 KnxDevice::KnxDevice() {
     _state = INIT;
-    _tpuart = NULL;
-    _txActionList = RingBuff<TxAction, ACTIONS_QUEUE_SIZE>();
+    _linesNb = 0;
+    _pendingAckLines = 0;
     _initCompleted = false;
-    _initIndex = 0;
-    _rxTelegram = NULL;
+    _initList = NULL;
+    _txCoalescing = false;
+    _txCurrent = 0;
+    _txNext = 1;
+    for (byte slot = 0; slot < KNX_TX_RETRY_SLOTS; slot++) _txRetry[slot] = 2 + slot;
+    _txRetryNb = 0;
+    _txNextReady = false;
+    _txDone = false;
+    _failedAckLines = 0;
+    for (byte level = 0; level < KNX_TX_LEVELS_NB; level++) _txMaxRetries[level] = 0;
+    _txRetryBackoff = KNX_TX_RETRY_BACKOFF_MS;
+    _txResultFunc = NULL;
+    for (byte level = 0; level < KNX_TX_LEVELS_NB; level++) _txRate[level] = 0;
+    _busLoad = 0;
+    _ownBusBytesNb = 0;
+    _txOverflowPolicy = KNX_TX_OVERFLOW_DROP_OLDEST;
+    _txDroppedNb = 0;
+    _taskMaxDurationMicros = 0;
+    _eventDispatchLimit = 0;
+    _comObjectFuncs = NULL;
+    _changedComObjects = NULL;
+    _rxRing = NULL;
 
     _progComObj.setAddr(G_ADDR(15, 7, 255));
 }
@@ -59,33 +94,92 @@ int KnxDevice::getNumberOfComObjects() {
  * else return KNX_DEVICE_OK
  */
 KnxDeviceStatus KnxDevice::begin(HardwareSerial& serial, word physicalAddr) {
-    delete _tpuart;  // always safe to delete null ptr
-    _tpuart = new KnxTpUart(serial, physicalAddr, NORMAL);
-    _rxTelegram = &_tpuart->getReceivedTelegram();
-    //delay(10000); // Workaround for init issue with bus-powered arduino
-    // the issue is reproduced on one (faulty?) TPUART device only, so remove it for the moment.
-    if (_tpuart->reset() != KNX_TPUART_OK) {
-        delete (_tpuart);
-        _tpuart = NULL;
-        _rxTelegram = NULL;
+    if (!placeComObjectValues()) {
+        DEBUG_PRINTLN(F("No memory for the com object values (%d bytes)!"), KnxComObject::getValueArenaUsed());
+        return KNX_DEVICE_INIT_ERROR;
+    }
+    deleteLines();
+    if (startLine(serial, physicalAddr, _rxRing) != KNX_DEVICE_OK) {
         DEBUG_PRINTLN(F("Init Error!"));
         return KNX_DEVICE_INIT_ERROR;
     }
-    _tpuart->attachComObjectsList(_comObjectsList, _numberOfComObjects);
-    _tpuart->setEvtCallback(&KnxDevice::getTpUartEvents);
-    _tpuart->setAckCallback(&KnxDevice::txTelegramAck);
-    _tpuart->init();
+    _pendingAckLines = 0;
+    _failedAckLines = 0;
+    _txDone = false;
     _state = IDLE;
     DEBUG_PRINTLN(F("Init successful"));
     _lastInitTimeMillis = millis();
     _lastRXTimeMicros = micros();
     _lastTXTimeMicros = _lastRXTimeMicros;
+    _lastTokenTimeMillis = _lastInitTimeMillis;
+    _lastBusLoadTimeMillis = _lastInitTimeMillis;
+    _busLoad = 0;
+    _ownBusBytesNb = 0;
+    _taskMaxDurationMicros = 0;
+    if (!_changedComObjects) {
+        _changedComObjects = (uint32_t*)malloc(((_numberOfComObjects + 31) / 32) * sizeof(uint32_t));
+        if (!_changedComObjects) DEBUG_PRINTLN(F("No memory for the changed com objects, nextChanged() disabled"));
+    }
+    if (_changedComObjects) memset(_changedComObjects, 0, ((_numberOfComObjects + 31) / 32) * sizeof(uint32_t));
 #if defined(KNXDEVICE_DEBUG_INFO)
     _nbOfInits = 0;
 #endif
     return KNX_DEVICE_OK;
 }
 
+// Add a KNX line driven by a further TPUART, with the physical address given to begin()
+KnxDeviceStatus KnxDevice::addLine(HardwareSerial& serial, KnxRxRing* ring) {
+    if ((_state == INIT) || (_linesNb == 0)) return KNX_DEVICE_INIT_ERROR;
+    if (_linesNb == KNX_DEVICE_MAX_LINES) return KNX_DEVICE_ERROR;
+    return startLine(serial, _tpuarts[0]->getPhysicalAddress(), ring);
+}
+
+// Create, reset and init the TPUART of a new line
+KnxDeviceStatus KnxDevice::startLine(HardwareSerial& serial, word physicalAddr, KnxRxRing* ring) {
+    KnxTpUart* tpuart = new KnxTpUart(serial, physicalAddr, NORMAL);
+    tpuart->attachRxRing(ring);
+    //delay(10000); // Workaround for init issue with bus-powered arduino
+    // the issue is reproduced on one (faulty?) TPUART device only, so remove it for the moment.
+    if (tpuart->reset() != KNX_TPUART_OK) {
+        delete (tpuart);
+        return KNX_DEVICE_INIT_ERROR;
+    }
+    tpuart->attachComObjectsList(_comObjectsList, _numberOfComObjects);
+    tpuart->setEvtCallback(&KnxDevice::getTpUartEvents);
+    tpuart->setAckCallback(&KnxDevice::txTelegramAck);
+    tpuart->init();
+    _busBytesNb[_linesNb] = tpuart->getBusBytesNb();
+    _tpuarts[_linesNb++] = tpuart;
+    return KNX_DEVICE_OK;
+}
+
+// Delete the TPUARTs of all the lines
+void KnxDevice::deleteLines(void) {
+    while (_linesNb) {
+        _linesNb--;
+        delete (_tpuarts[_linesNb]);
+    }
+}
+
+// Place the com object values in the arena, the programming com object first
+// Done once (by begin() or an earlier restoreValue()), the values are kept over end() and begin()
+boolean KnxDevice::placeComObjectValues(void) {
+    if (KnxComObject::isValueArenaAllocated()) return true;
+    if (!KnxComObject::getValueArenaUsed()) {
+        _progComObj.reserveValue();
+        for (byte i = 0; i < _numberOfComObjects; i++) _comObjectsList[i].reserveValue();
+    }
+    if (KnxComObject::getValueArenaUsed() > KNX_COMOBJ_VALUE_ARENA_SIZE) {
+        DEBUG_PRINTLN(F("Com object values need %d bytes, more than KNX_COMOBJ_VALUE_ARENA_SIZE : heap used"), KnxComObject::getValueArenaUsed());
+    }
+    return KnxComObject::allocValueArena();
+}
+
+// Set the ring fed by the UART RX interrupt, attached to the TPUART on begin()
+void KnxDevice::setRxRing(KnxRxRing* ring) {
+    _rxRing = ring;
+}
+
 // Stop the KNX Device
 void KnxDevice::end() {
     //TxAction action;
@@ -94,16 +188,15 @@ void KnxDevice::end() {
         //;  // empty ring buffer
         //
         // ensure all telegrams are sent
-        while (_txActionList.getItemCount()>0) {
+        while ((_txActionList.getItemCount() > 0) || _txNextReady || _txRetryNb) {
             DEBUG_PRINTLN(F("KnxDevice::end working on open tasks: %d"), _txActionList.getItemCount());
             task();
         }
     _state = INIT;
     _initCompleted = false;
-    _initIndex = 0;
-    _rxTelegram = NULL;
-    delete (_tpuart);
-    _tpuart = NULL;
+    free(_initList);
+    _initList = NULL;
+    deleteLines();
     DEBUG_PRINTLN(F("KnxDevice::end *done*"));
 }
 
@@ -111,114 +204,213 @@ void KnxDevice::end() {
  * KNX device execution task
  * This function call shall be placed in the "loop()" Arduino function
  */
-void KnxDevice::task(void) {
+unsigned long KnxDevice::task(void) {
+    unsigned long startTimeMicros = micros();
+    unsigned long duration;
+
+    //stay in task() if a TPUART isActive()
+    do {
+        taskStep();
+    } while (KNX_DEVICE_TASK_BLOCKING && isLineActive());
+
+    // The received values are notified once the timing critical work is done
+    dispatchEvents();
+
+    duration = micros() - startTimeMicros;
+    if (duration > _taskMaxDurationMicros) _taskMaxDurationMicros = duration;
+    return nextDeadline();
+}
+
+/**
+ * KNX device execution task, cooperative mode
+ * The steps go on while a line is active, as long as the next deadline falls within the time budget
+ */
+unsigned long KnxDevice::task(word budgetMicros) {
+    unsigned long startTimeMicros = micros();
+    unsigned long duration, deadline;
+
+    while (true) {
+        taskStep();
+        deadline = nextDeadline();
+        duration = micros() - startTimeMicros;
+        if (!isLineActive() || (duration >= budgetMicros) || (deadline > budgetMicros - duration)) break;
+    }
+
+    // The received values are notified once the timing critical work is done
+    dispatchEvents();
+    deadline = nextDeadline();
+    duration = micros() - startTimeMicros;
+
+    if (duration > _taskMaxDurationMicros) _taskMaxDurationMicros = duration;
+    return deadline;
+}
+
+// Run one step of the KNX device task
+void KnxDevice::taskStep(void) {
     TxAction action;
+    KnxTelegram* rxTelegram;
+    byte line, slot;
     word nowTimeMillis, nowTimeMicros;
+    boolean txStarted;
+    byte swapped;
+
+    // STEP 1 : Initialize Com Objects having Init Read attribute
+    if (!_initCompleted) initTask(millis());
+
+    // STEP 2 : Get new received KNX messages from the TPUART
+    // The TPUART RX task is executed every 400 us
+    nowTimeMicros = micros();
+    if (TimeDeltaWord(nowTimeMicros, _lastRXTimeMicros) > KNX_DEVICE_RX_PERIOD_US) {
+        _lastRXTimeMicros = nowTimeMicros;
+        for (line = 0; line < _linesNb; line++) _tpuarts[line]->rxTask();
+        
+        // TODO: check for rx_state in tpuart and call rxtask repeatedly until telegram is received?!
+    }
 
-    //stay in task() if _tpuart.isActive()
-    do {
+    // Process the telegrams queued by the TPUARTs
+    // NB : the telegram is released only once processed, as task() may be called again meanwhile (e.g. by knxEvents)
+    for (line = 0; line < _linesNb; line++) {
+        while ((rxTelegram = _tpuarts[line]->takeReceivedTelegram()) != NULL) {
+            processReceivedTelegram(*rxTelegram);
+            _tpuarts[line]->releaseReceivedTelegram(rxTelegram);
+        }
+    }
 
-        // STEP 1 : Initialize Com Objects having Init Read attribute
-        if (!_initCompleted) {
-            nowTimeMillis = millis();
-            // To avoid KNX bus overloading, we wait for 500 ms between each Init read request
-            if (TimeDeltaWord(nowTimeMillis, _lastInitTimeMillis) > 500) {
-                while (
-                    (_initIndex < _numberOfComObjects) &&
-                    (_comObjectsList[_initIndex].getValidity() || !_comObjectsList[_initIndex].isActive()) /* either valid (=init done or not required) or not-active required to jump to next index */
-                    ) _initIndex++;
-
-                if (_initIndex == _numberOfComObjects) {
-                    _initCompleted = true;  // All the Com Object initialization have been performed
-                } else {                    // Com Object to be initialised has been found
-                    // Add a READ request in the TX action list
-                    action.command = KNX_READ_REQUEST;
-                    action.index = _initIndex;
-                    _txActionList.append(action);
-                    _lastInitTimeMillis = millis();  // Update the timer
-                }
-            }
+    // STEP 3 : Send KNX messages following TX actions
+    // The retry backoffs only elapse while the bus is idle
+    nowTimeMillis = millis();
+    if (_txRetryNb && !isLineActive()) {
+        word elapsed = TimeDeltaWord(nowTimeMillis, _lastRetryTimeMillis);
+        for (slot = 0; slot < _txRetryNb; slot++) {
+            byte retry = _txRetry[slot];
+            _txRetryWait[retry] = (_txRetryWait[retry] > elapsed ? _txRetryWait[retry] - elapsed : 0);
         }
+    }
+    _lastRetryTimeMillis = nowTimeMillis;
+
+    if (_txDone) handleTxOutcome();
 
-        // STEP 2 : Get new received KNX messages from the TPUART
-        // The TPUART RX task is executed every 400 us
-        nowTimeMicros = micros();
-        if (TimeDeltaWord(nowTimeMicros, _lastRXTimeMicros) > 400) {
-            _lastRXTimeMicros = nowTimeMicros;
-            _tpuart->rxTask();
-            
-            // TODO: check for rx_state in tpuart and call rxtask repeatedly until telegram is received?!
+    updateTxRateLimiter(nowTimeMillis);
+
+    // The telegram of the next action is built in advance while the current one is being sent,
+    // so it is handed over to the TPUARTs as soon as the current one is confirmed
+    // Only the levels which have a token left are served
+    while (!_txNextReady && _txActionList.popAllowed(action, allowedTxLevels())) {
+        _txNextReady = encodeTxAction(action, _txTelegrams[_txNext]);
+        _txObjIndex[_txNext] = action.index;
+        if (_txNextReady) {
+            byte level = KnxTxLevel(_txTelegrams[_txNext].getPriority());
+            _txTokens[level] = (_txTokens[level] > 1000 ? _txTokens[level] - 1000 : 0);
+        }
+    }
+    txStarted = false;
+    if ((_state == IDLE) && !_pendingAckLines) {
+        slot = getTxRetryReady();
+        if (slot < _txRetryNb) {
+            // backoff over, the retry telegram is sent again on the lines which failed
+            // and its slot gets the buffer of the former current telegram (free slots are kept after the used ones)
+            swapped = _txCurrent; _txCurrent = _txRetry[slot];
+            for (_txRetryNb--; slot < _txRetryNb; slot++) _txRetry[slot] = _txRetry[slot + 1];
+            _txRetry[slot] = swapped;
+            _txAttempts[_txCurrent]++;
+            sendTxTelegram(_txRetryLines[_txCurrent]);
+            txStarted = true;
+        } else if (_txNextReady && isTxNextAllowed()) {
+            swapped = _txCurrent; _txCurrent = _txNext; _txNext = swapped;
+            _txNextReady = false;
+            _txAttempts[_txCurrent] = 1;
+            sendTxTelegram((1 << _linesNb) - 1);
+            txStarted = true;
         }
+    }
 
-        // STEP 3 : Send KNX messages following TX actions
-        if (_state == IDLE) {
-            if (_txActionList.pop(action)) { // Data to be transmitted
-                
-                //DEBUG_PRINTLN(F("Data to be transmitted index=%d"), action.index);
-                KnxComObject* comObj = (action.index == 255 ? &_progComObj : &_comObjectsList[action.index]);
-                
-                //}
-                
-                switch (action.command) {
-                    
-                    case KNX_READ_REQUEST: // a read operation of a Com Object on the KNX network is required
-                        //_objectsList[action.index].CopyToTelegram(_txTelegram, KNX_COMMAND_VALUE_READ);
-                            comObj->copyAttributes(_txTelegram);
-                            _txTelegram.clearLongPayload();
-                            _txTelegram.clearFirstPayloadByte(); // Is it required to have a clean payload ??
-                            _txTelegram.setCommand(KNX_COMMAND_VALUE_READ);
-                            _txTelegram.updateChecksum();
-                            _tpuart->sendTelegram(_txTelegram);
-                            _state = TX_ONGOING;
-                            break;
-
-                    case KNX_RESPONSE_REQUEST: // a response operation of a Com Object on the KNX network is required
-                        comObj->copyAttributes(_txTelegram);
-                        comObj->copyValue(_txTelegram);
-                        _txTelegram.setCommand(KNX_COMMAND_VALUE_RESPONSE);
-                        _txTelegram.updateChecksum();
-                        _tpuart->sendTelegram(_txTelegram);
-                        _state = TX_ONGOING;
-                        break;
-
-                    case KNX_WRITE_REQUEST: // a write operation of a Com Object on the KNX network is required
-                        // update the com obj value
-                        //DEBUG_PRINTLN(F("KNX_WRITE_REQUEST index=%d"), action.index);
-                        
-                        
-                        if ((comObj->getLength()) <= 2) {
-                            //DEBUG_PRINTLN(F("len <= 2"));
-                            comObj->updateValue(action.byteValue);
-                        } else {
-                            //DEBUG_PRINTLN(F("len > 2"));
-                            comObj->updateValue(action.valuePtr);
-                            free(action.valuePtr);
-                        }
-                        // transmit the value through KNX network only if the Com Object has transmit attribute
-                        if ((comObj->getIndicator()) & KNX_COM_OBJ_T_INDICATOR) {
-                            //DEBUG_PRINTLN(F("set tx ongoing"));
-                            comObj->copyAttributes(_txTelegram);
-                            comObj->copyValue(_txTelegram);
-                            _txTelegram.setCommand(KNX_COMMAND_VALUE_WRITE);
-                            _txTelegram.updateChecksum();
-                            _tpuart->sendTelegram(_txTelegram);
-                            _state = TX_ONGOING;
-                        }
-                        break;
-
-                    default: break;
-                }
-            }
+    // STEP 4 : LET THE TP-UART TRANSMIT KNX MESSAGES
+    // The TPUART TX task is executed every 800 us, and right away when a telegram has just been handed over
+    nowTimeMicros = micros();
+    if (txStarted || (TimeDeltaWord(nowTimeMicros, _lastTXTimeMicros) > KNX_DEVICE_TX_PERIOD_US)) {
+        _lastTXTimeMicros = nowTimeMicros;
+        for (line = 0; line < _linesNb; line++) _tpuarts[line]->txTask();
+    }
+}
+
+/**
+ * Time (in usec) before task() shall be called, i.e. the earliest of :
+ * - the next TPUART RX task, unless the RX ring is empty and no telegram is being received
+ * - the next TPUART TX task, while a telegram is being sent
+ * - a TX action, retry or Init READ request to be sent (0 unless delayed by the rate limiter or a backoff)
+ * - an Init READ request timeout
+ * - a received value event left by the dispatch limit
+ */
+unsigned long KnxDevice::nextDeadline(void) const {
+    unsigned long deadline = KNX_DEVICE_NO_DEADLINE;
+    unsigned long delay;
+    word nowTimeMicros = micros();
+    word nowTimeMillis = millis();
+    word elapsed;
+    byte line, level, slot;
+    boolean rxQueueFull = false;
+
+    // TPUART tasks
+    for (line = 0; line < _linesNb; line++) {
+        if (_tpuarts[line]->isRxQueueFull()) rxQueueFull = true;
+        if (_tpuarts[line]->isRxPollingRequired()) {
+            elapsed = TimeDeltaWord(nowTimeMicros, _lastRXTimeMicros);
+            delay = (elapsed < KNX_DEVICE_RX_PERIOD_US ? KNX_DEVICE_RX_PERIOD_US - elapsed : 0);
+            if (delay < deadline) deadline = delay;
         }
+        if (_tpuarts[line]->isActive()) {
+            elapsed = TimeDeltaWord(nowTimeMicros, _lastTXTimeMicros);
+            delay = (elapsed < KNX_DEVICE_TX_PERIOD_US ? KNX_DEVICE_TX_PERIOD_US - elapsed : 0);
+            if (delay < deadline) deadline = delay;
+        }
+    }
+
+    // A full RX queue is released by the task() call processing it (task() called again from a callback) :
+    // till then the telegrams are answered BUSY, only the RX/TX polling goes on
+    if (rxQueueFull) return deadline;
+
+    // Received value events left by the dispatch limit
+    if (_events.getItemCount()) return 0;
 
-        // STEP 4 : LET THE TP-UART TRANSMIT KNX MESSAGES
-        // The TPUART TX task is executed every 800 us
-        nowTimeMicros = micros();
-        if (TimeDeltaWord(nowTimeMicros, _lastTXTimeMicros) > 800) {
-            _lastTXTimeMicros = nowTimeMicros;
-            _tpuart->txTask();
+    // TX actions
+    if (_txDone) return 0;
+    if ((_state == IDLE) && !_pendingAckLines) {
+        if (_txNextReady && isTxNextAllowed()) return 0;
+        for (slot = 0; slot < _txRetryNb; slot++) {
+            delay = (unsigned long)_txRetryWait[_txRetry[slot]] * 1000;  // counted only while the bus is idle
+            if (delay < deadline) deadline = delay;
         }
-    } while (_tpuart->isActive());
+    }
+    if (!_txNextReady) {
+        // the actions of a limited level wait for their token
+        byte share = (_busLoad < 100 - KNX_TX_RATE_MIN_SHARE ? 100 - _busLoad : KNX_TX_RATE_MIN_SHARE);
+        for (level = 0; level < KNX_TX_LEVELS_NB; level++) {
+            if (!_txActionList.getItemCount(level)) continue;
+            if (!_txRate[level] || (_txTokens[level] >= 1000)) return 0;
+            unsigned long refill = (unsigned long)_txRate[level] * share;  // tokens per msec, x100
+            delay = (((unsigned long)(1000 - _txTokens[level]) * 100 + refill - 1) / refill) * 1000;
+            if (delay < deadline) deadline = delay;
+        }
+    }
+
+    // Init READ requests
+    if (!_initCompleted) {
+        if (!_initList) return 0;
+        for (slot = 0; slot < KNX_INIT_READS_MAX; slot++) {
+            if (_initReadIndex[slot] == 255) {
+                if (_initListHead < _initListNb) {
+                    elapsed = TimeDeltaWord(nowTimeMillis, _lastInitTimeMillis);
+                    delay = (elapsed < KNX_INIT_READ_INTERVAL_MS ? KNX_INIT_READ_INTERVAL_MS - elapsed : 0) * 1000UL;
+                    if (delay < deadline) deadline = delay;
+                }
+            } else {
+                elapsed = TimeDeltaWord(nowTimeMillis, _initReadTime[slot]);
+                delay = (elapsed <= KNX_INIT_READ_TIMEOUT_MS ? KNX_INIT_READ_TIMEOUT_MS + 1 - elapsed : 0) * 1000UL;
+                if (delay < deadline) deadline = delay;
+            }
+        }
+    }
+    return deadline;
 }
 
 /**
@@ -286,7 +478,6 @@ KnxDeviceStatus KnxDevice::read(byte objectIndex, byte returnedValue[]) {
 template <typename T>
 KnxDeviceStatus KnxDevice::write(byte objectIndex, T value) {
     TxAction action;
-    byte* destValue;
     //DEBUG_PRINTLN(F("KnxDevice::write 1"));
     KnxComObject* comObj = (objectIndex == 255 ? &_progComObj : &_comObjectsList[objectIndex]);
     if (!comObj->isActive()) {
@@ -301,26 +492,19 @@ KnxDeviceStatus KnxDevice::write(byte objectIndex, T value) {
         action.byteValue = (byte)value;         // short object case
     } else {                                      // long object case, let's try to translate value to the com object DPT
         //DEBUG_PRINTLN(F("KnxDevice::write 5"));
-        destValue = (byte*)malloc(length - 1);  // allocate the memory for DPT
-        //DEBUG_PRINTLN(F("KnxDevice::write 6"));
-        KnxDeviceStatus status = ConvertToDpt(value, destValue, pgm_read_byte(&KnxDptToFormat[comObj->getDptId()]));
+        KnxDeviceStatus status = ConvertToDpt(value, action.longValue, pgm_read_byte(&KnxDptToFormat[comObj->getDptId()]));
         //DEBUG_PRINTLN(F("KnxDevice::write 7"));
         if (status)  // translation error
         {
-            free(destValue);
             //DEBUG_PRINTLN(F("KnxDevice::write 8"));
             return status;  // we cannot convert, we stop here
-        } else {
-            action.valuePtr = destValue;
-            //DEBUG_PRINTLN(F("KnxDevice::write 9"));
         }
     }
     // add WRITE action in the TX action queue
     action.command = KNX_WRITE_REQUEST;
     action.index = objectIndex;
-    _txActionList.append(action);
     //DEBUG_PRINTLN(F("KnxDevice::write 10"));
-    return KNX_DEVICE_OK;
+    return queueTxAction(action);
 }
 
 template KnxDeviceStatus KnxDevice::write<bool>(byte objectIndex, bool value);
@@ -352,40 +536,48 @@ KnxDeviceStatus KnxDevice::write(byte objectIndex, byte valuePtr[]) {
         action.command = KNX_WRITE_REQUEST;
         action.index = objectIndex;
 
-        // allocate the memory for long value
-        byte* dptValue = (byte*)malloc(length - 1);
-
         for (byte i = 0; i < length - 1; i++) {
-            dptValue[i] = valuePtr[i];  // copy value
+            action.longValue[i] = valuePtr[i];  // copy value
         }
-        action.valuePtr = (byte*)dptValue;
-
-        _txActionList.append(action);
 
-        return KNX_DEVICE_OK;
+        return queueTxAction(action);
     }
     return KNX_DEVICE_ERROR;
 }
 
+/**
+ * Set a com object value restored from a persistent storage (rough DPT value shall be provided)
+ * The value is updated locally only and the com object is no longer initialized by an Init READ request
+ */
+KnxDeviceStatus KnxDevice::restoreValue(byte objectIndex, const byte valuePtr[]) {
+    if (objectIndex >= _numberOfComObjects) return KNX_DEVICE_INVALID_INDEX;
+    if (!placeComObjectValues()) return KNX_DEVICE_ERROR;  // may be called before begin()
+    _comObjectsList[objectIndex].updateValue(valuePtr);  // the com object is set to valid
+    return KNX_DEVICE_OK;
+}
+
 /**
  *  Com Object KNX Bus Update request
  * Request the local object to be updated with the value from the bus
  * NB : the function is asynchroneous, the update completion is notified by the knxEvents() callback
+ * return KNX_DEVICE_TX_QUEUE_FULL if the request cannot be queued, else KNX_DEVICE_OK
  */
-void KnxDevice::update(byte objectIndex) {
+KnxDeviceStatus KnxDevice::update(byte objectIndex) {
     TxAction action;
     action.command = KNX_READ_REQUEST;
     action.index = objectIndex;
-    _txActionList.append(action);
+    return queueTxAction(action);
 }
 
 /**
  *  The function returns true if there is rx/tx activity ongoing, else false
  */
 bool KnxDevice::isActive() const {
-    if (_tpuart->isActive()) return true;           // TPUART is active
+    if (isLineActive()) return true;                // a TPUART is active
     if (_state == TX_ONGOING) return true;          // the Device is sending a request
     if (_txActionList.getItemCount()) return true;  // there is at least one tx action in the queue
+    if (_txNextReady) return true;                  // a telegram is ready to be sent
+    if (_txRetryNb) return true;                    // a telegram waits for a retry
     return false;
 }
 
@@ -395,6 +587,38 @@ KnxDeviceStatus KnxDevice::setComObjectAddress(byte index, word addr) {
     _comObjectsList[index].setAddr(addr);
     return KNX_DEVICE_OK;
 }
+KnxDeviceStatus KnxDevice::setComObjectPriority(byte index, e_KnxPriority priority) {
+    if (index >= _numberOfComObjects) return KNX_DEVICE_INVALID_INDEX;
+    _comObjectsList[index].setPriority(priority);
+    return KNX_DEVICE_OK;
+}
+void KnxDevice::setTxCoalescing(bool coalescing) {
+    _txCoalescing = coalescing;
+}
+void KnxDevice::setTxRetries(e_KnxPriority priority, byte retries) {
+    _txMaxRetries[KnxTxLevel(priority)] = retries;
+}
+void KnxDevice::setTxRetryBackoff(word backoffMillis) {
+    _txRetryBackoff = backoffMillis;
+}
+void KnxDevice::setTxResultFunc(void (*func)(byte, KnxTxResult)) {
+    _txResultFunc = func;
+}
+void KnxDevice::setTxRateLimit(e_KnxPriority priority, byte telegramsPerSecond, byte burst) {
+    byte level = KnxTxLevel(priority);
+    if (burst < 1) burst = 1;
+    if (burst > KNX_TX_RATE_MAX_BURST) burst = KNX_TX_RATE_MAX_BURST;
+    _txRate[level] = telegramsPerSecond;
+    _txBurst[level] = burst;
+    _txTokens[level] = burst * 1000;  // full bucket
+}
+void KnxDevice::setTxOverflowPolicy(KnxTxOverflowPolicy policy) {
+    _txOverflowPolicy = policy;
+}
+void KnxDevice::resetTxQueueStats(void) {
+    _txActionList.resetMaxItemCount();
+    _txDroppedNb = 0;
+}
 KnxDeviceStatus KnxDevice::setComObjectIndicator(byte index, byte indicator) {
     if (_state != INIT) return KNX_DEVICE_INIT_ERROR;
     if (index >= _numberOfComObjects) return KNX_DEVICE_INVALID_INDEX;
@@ -402,94 +626,404 @@ KnxDeviceStatus KnxDevice::setComObjectIndicator(byte index, byte indicator) {
     return KNX_DEVICE_OK;
 }
 
+KnxDeviceStatus KnxDevice::setComObjectCallback(byte index, void (*func)(byte)) {
+    KnxComObjectFunc* entry;
+    KnxDeviceStatus status = comObjectFunc(index, (func ? KNX_COMOBJ_FUNC_INDEX : KNX_COMOBJ_FUNC_NONE), entry);
+    if (status != KNX_DEVICE_OK) return status;
+    entry->type = (func ? KNX_COMOBJ_FUNC_INDEX : KNX_COMOBJ_FUNC_NONE);
+    entry->func.index = func;
+    return KNX_DEVICE_OK;
+}
+KnxDeviceStatus KnxDevice::setComObjectCallback(byte index, void (*func)(byte, bool)) {
+    KnxComObjectFunc* entry;
+    KnxDeviceStatus status = comObjectFunc(index, (func ? KNX_COMOBJ_FUNC_BOOL : KNX_COMOBJ_FUNC_NONE), entry);
+    if (status != KNX_DEVICE_OK) return status;
+    entry->type = (func ? KNX_COMOBJ_FUNC_BOOL : KNX_COMOBJ_FUNC_NONE);
+    entry->func.boolValue = func;
+    return KNX_DEVICE_OK;
+}
+KnxDeviceStatus KnxDevice::setComObjectCallback(byte index, void (*func)(byte, word)) {
+    KnxComObjectFunc* entry;
+    KnxDeviceStatus status = comObjectFunc(index, (func ? KNX_COMOBJ_FUNC_WORD : KNX_COMOBJ_FUNC_NONE), entry);
+    if (status != KNX_DEVICE_OK) return status;
+    entry->type = (func ? KNX_COMOBJ_FUNC_WORD : KNX_COMOBJ_FUNC_NONE);
+    entry->func.wordValue = func;
+    return KNX_DEVICE_OK;
+}
+KnxDeviceStatus KnxDevice::setComObjectCallback(byte index, void (*func)(byte, float)) {
+    KnxComObjectFunc* entry;
+    KnxDeviceStatus status = comObjectFunc(index, (func ? KNX_COMOBJ_FUNC_FLOAT : KNX_COMOBJ_FUNC_NONE), entry);
+    if (status != KNX_DEVICE_OK) return status;
+    entry->type = (func ? KNX_COMOBJ_FUNC_FLOAT : KNX_COMOBJ_FUNC_NONE);
+    entry->func.floatValue = func;
+    return KNX_DEVICE_OK;
+}
+
+// Get the next changed com object, 32 com objects being scanned at once
+int KnxDevice::nextChanged(int startIndex) {
+    if (!_changedComObjects || (startIndex < 0) || (startIndex >= _numberOfComObjects)) return -1;
+
+    byte wordsNb = (_numberOfComObjects + 31) / 32;
+    byte i = startIndex >> 5;
+    uint32_t changed = _changedComObjects[i] & ((uint32_t)0xFFFFFFFF << (startIndex & 31));
+    while (!changed) {
+        if (++i == wordsNb) return -1;
+        changed = _changedComObjects[i];
+    }
+    byte bit = __builtin_ctzl(changed);
+    _changedComObjects[i] &= ~((uint32_t)1 << bit);
+    return (i << 5) + bit;
+}
+
 word KnxDevice::getComObjectAddress(byte index) {
     return _comObjectsList[index].getAddr();
 }
 
 /**
- * Static getTpUartEvents() function called by the KnxTpUart layer (callback)
+ * Queue a TX action in the FIFO of its com object priority
+ * When the queue is full, the TX overflow policy applies :
+ * - DROP_OLDEST : the oldest action of the lowest priority level is dropped to make room,
+ *   unless this level is of higher priority than the new action (which is then rejected)
+ * - REJECT_NEW : the new action is rejected
+ * - COALESCE : the new action replaces the last queued action of the same type for the same com object,
+ *   if any, else it is rejected
+ * 
+ * @param action the action to queue
+ * @return KNX_DEVICE_TX_QUEUE_FULL if the action is rejected, else KNX_DEVICE_OK
+ */
+KnxDeviceStatus KnxDevice::queueTxAction(const TxAction& action) {
+    KnxComObject* comObj = (action.index == 255 ? &_progComObj : &_comObjectsList[action.index]);
+    byte level = KnxTxLevel(comObj->getPriority());
+    boolean coalescing = _txCoalescing && (action.command == KNX_WRITE_REQUEST) && (action.index != 255);
+    TxAction dropped;
+    byte slot;
+
+    if (coalescing && (comObj->getPendingTxSlot() != KNX_TX_QUEUE_NONE)) {
+        // last value wins : the pending WRITE takes the new value
+        _txActionList.getAction(comObj->getPendingTxSlot()) = action;
+        return KNX_DEVICE_OK;
+    }
+
+    if (_txActionList.isFull()) {
+        switch (_txOverflowPolicy) {
+            case KNX_TX_OVERFLOW_DROP_OLDEST: {
+                byte droppedLevel = KNX_TX_LEVEL_NORMAL;
+                while (!_txActionList.getItemCount(droppedLevel)) droppedLevel--;
+                if (droppedLevel < level) break;  // the queue is full of higher priority actions, reject the new one
+                _txActionList.pop(dropped, droppedLevel);
+                if (_txDroppedNb < 0xFFFF) _txDroppedNb++;
+                DEBUG_PRINTLN(F("TX queue full, action dropped for comobj %d"), dropped.index);
+                // forget a dropped WRITE as pending
+                if (dropped.command == KNX_WRITE_REQUEST) {
+                    (dropped.index == 255 ? &_progComObj : &_comObjectsList[dropped.index])->setPendingTxSlot(KNX_TX_QUEUE_NONE);
+                }
+                break;
+            }
+
+            case KNX_TX_OVERFLOW_COALESCE:
+                slot = _txActionList.find(action, level);
+                if (slot != KNX_TX_QUEUE_NONE) {
+                    _txActionList.getAction(slot) = action;
+                    return KNX_DEVICE_OK;
+                }
+                break;  // no action to coalesce with, reject the new one
+
+            default: // KNX_TX_OVERFLOW_REJECT_NEW
+                break;
+        }
+        if (_txActionList.isFull()) {
+            if (_txDroppedNb < 0xFFFF) _txDroppedNb++;
+            DEBUG_PRINTLN(F("TX queue full, action rejected for comobj %d"), action.index);
+            return KNX_DEVICE_TX_QUEUE_FULL;
+        }
+    }
+    slot = _txActionList.append(action, level);
+    if (coalescing) comObj->setPendingTxSlot(slot);
+    return KNX_DEVICE_OK;
+}
+
+/**
+ * Init task (called from task() until all the com objects with Init attribute are initialized)
+ * Up to KNX_INIT_READS_MAX READ requests wait for their response at the same time, each com object being released
+ * as soon as it gets valid (i.e. its response, or a WRITE from the bus, has been received)
+ * A request without response is sent again after KNX_INIT_READ_TIMEOUT_MS, up to KNX_INIT_READ_ATTEMPTS times
+ * 
+ * @param nowTimeMillis current time
+ */
+void KnxDevice::initTask(word nowTimeMillis) {
+    byte slot, index;
+    boolean waiting = false;
+
+    if (!_initList) {
+        buildInitList();
+        if (!_initList) return;  // nothing to initialize
+    }
+
+    // follow the pending requests
+    for (slot = 0; slot < KNX_INIT_READS_MAX; slot++) {
+        index = _initReadIndex[slot];
+        if (index == 255) continue;
+        if (_comObjectsList[index].getValidity()) {
+            _initReadIndex[slot] = 255;  // the com object is initialized
+            continue;
+        }
+        if (TimeDeltaWord(nowTimeMillis, _initReadTime[slot]) > KNX_INIT_READ_TIMEOUT_MS) {
+            if (_initReadAttempts[slot] >= KNX_INIT_READ_ATTEMPTS) {
+                DEBUG_PRINTLN(F("Init of comobj %d failed, no response"), index);
+                _initReadIndex[slot] = 255;
+                continue;
+            }
+            if (update(index) == KNX_DEVICE_OK) {
+                _initReadAttempts[slot]++;
+                _initReadTime[slot] = nowTimeMillis;
+            }
+        }
+        waiting = true;
+    }
+
+    // send the requests of the next com objects, in the free slots
+    for (slot = 0; slot < KNX_INIT_READS_MAX; slot++) {
+        if (_initReadIndex[slot] != 255) continue;
+        if (TimeDeltaWord(nowTimeMillis, _lastInitTimeMillis) < KNX_INIT_READ_INTERVAL_MS) break;
+        // skip the com objects got valid meanwhile (restored value, WRITE from the bus...)
+        while ((_initListHead < _initListNb) && _comObjectsList[_initList[_initListHead]].getValidity()) _initListHead++;
+        if (_initListHead == _initListNb) break;
+        index = _initList[_initListHead];
+        if (update(index) != KNX_DEVICE_OK) break;  // TX queue full, let's try again later
+        _initListHead++;
+        _initReadIndex[slot] = index;
+        _initReadTime[slot] = nowTimeMillis;
+        _initReadAttempts[slot] = 1;
+        _lastInitTimeMillis = nowTimeMillis;
+        waiting = true;
+    }
+
+    if (!waiting && (_initListHead == _initListNb)) {
+        _initCompleted = true;  // All the Com Object initialization have been performed
+        free(_initList);
+        _initList = NULL;
+    }
+}
+
+/**
+ * Build the list of the com objects to be initialized, i.e. the active ones which are not valid yet
+ * The list is allocated once, it is freed when the init is completed
  */
-void KnxDevice::getTpUartEvents(KnxTpUartEvent event) {
+void KnxDevice::buildInitList(void) {
+    byte index, nb = 0;
+
+    for (index = 0; index < _numberOfComObjects; index++) {
+        if (!_comObjectsList[index].getValidity() && _comObjectsList[index].isActive()) nb++;
+    }
+    if (nb) _initList = (byte*)malloc(nb);
+    if (!_initList) {
+        if (nb) DEBUG_PRINTLN(F("Init list allocation failed"));
+        _initCompleted = true;
+        return;
+    }
+    _initListNb = 0;
+    for (index = 0; index < _numberOfComObjects; index++) {
+        if (!_comObjectsList[index].getValidity() && _comObjectsList[index].isActive()) _initList[_initListNb++] = index;
+    }
+    _initListHead = 0;
+    for (byte slot = 0; slot < KNX_INIT_READS_MAX; slot++) _initReadIndex[slot] = 255;
+}
+
+/**
+ * Process a telegram received by the TPUART (called from task())
+ * The addressed com objects are updated and the READ requests are answered
+ * 
+ * @param telegram the received telegram
+ */
+void KnxDevice::processReceivedTelegram(KnxTelegram& telegram) {
     TxAction action;
-    byte targetedComObjIndex;  // index of the Com Object targeted by the event
+    byte targetedComObjIndex;  // index of the Com Object targeted by the telegram
+
+    _state = IDLE;
+
+    AddressedComObjects addressedComObjects = _tpuarts[0]->getAddressedComObjects(telegram);
+
+    //DEBUG_PRINTLN(F("  KnxDevice::getTpUartEvents need to process %d comobjs."), addressedComObjects.items);
+
+    // handle all addressed comobjs
+    for (int i = 0; i < addressedComObjects.items; i++) {
+        targetedComObjIndex = addressedComObjects.list[i];
+
+        KnxComObject* comObj = (targetedComObjIndex == 255 ? &_progComObj : &_comObjectsList[targetedComObjIndex]);
+
+        //DEBUG_PRINTLN(F("  KnxDevice::getTpUartEvents targetedComObjIndex=%d command=%d"), targetedComObjIndex, telegram.getCommand());
+
+        byte indicator = comObj->getIndicator();
+
+        switch (telegram.getCommand()) {
+            case KNX_COMMAND_VALUE_READ:
+                // READ command coming from the bus
+                // if the Com Object has read attribute, then add RESPONSE action in the TX action list
+                if ((indicator) & KNX_COM_OBJ_R_INDICATOR) {  // The targeted Com Object can indeed be read
+                    action.command = KNX_RESPONSE_REQUEST;
+                    action.index = targetedComObjIndex;
+                    queueTxAction(action);
+                }
+                break;
+
+            case KNX_COMMAND_VALUE_RESPONSE:
+                // RESPONSE command coming from KNX network, we update the value of the corresponding Com Object.
+                // We 1st check that the corresponding Com Object has UPDATE attribute
+                if ((indicator) & KNX_COM_OBJ_U_INDICATOR) {
+                    // The com object is updated now, the upper layer is notified when the event is dispatched
+                    receiveValue(telegram, targetedComObjIndex, *comObj);
+                }
+                break;
+
+            case KNX_COMMAND_VALUE_WRITE:
+                // WRITE command coming from KNX network, we update the value of the corresponding Com Object.
+                // We 1st check that the corresponding Com Object has WRITE attribute
+
+                //DEBUG_PRINTLN(F("  KNX_COMMAND_VALUE_WRITE: ComObj Indicator=0x%02X"), indicator);
+                if ((indicator) & KNX_COM_OBJ_W_INDICATOR) {
+                    // The com object is updated now, the upper layer is notified when the event is dispatched
+                    receiveValue(telegram, targetedComObjIndex, *comObj);
+                } else {
+                    //DEBUG_PRINTLN(F(    "Wrong config byte on comobj #%d: 0x%02X"), targetedComObjIndex, indicator);
+                }
+                break;
+
+                // case KNX_COMMAND_MEMORY_WRITE : break; // Memory Write not handled
+
+            default:
+                break;  // not supposed to happen
+        }
+    }
+}
+
+// Update the com object with a received value, and queue the event to notify the upper layer
+void KnxDevice::receiveValue(const KnxTelegram& telegram, byte index, KnxComObject& comObj) {
+    KnxEvent event = receivedEvent(telegram, index, comObj);
+
+    if (event.hasValue) {
+        comObj.updateValue(event.value);  // the com object is set to valid
+        if (_changedComObjects && (index != 255)) _changedComObjects[index >> 5] |= (uint32_t)1 << (index & 31);
+    }
+    queueEvent(event);
+}
+
+// Queue a received value event
+void KnxDevice::queueEvent(const KnxEvent& event) {
+    KnxEvent oldest;
+
+    // The programming com object is handled right away, as the KONNEKTING protocol answers it
+    if (event.index == 255) {
+        dispatchEvent(event);
+        return;
+    }
+    // Ring full : the oldest event is dispatched to make room, so that no update is lost
+    if (_events.getItemCount() == KNX_DEVICE_EVENTS_NB) {
+        _events.pop(oldest);
+        dispatchEvent(oldest);
+    }
+    _events.append(event);
+}
+
+// Dispatch the queued events
+// NB : the event is popped before being dispatched, as task() may be called again meanwhile (e.g. by knxEvents)
+void KnxDevice::dispatchEvents(void) {
+    KnxEvent event;
+    byte dispatchedNb = 0;
+
+    while ((!_eventDispatchLimit || (dispatchedNb < _eventDispatchLimit)) && _events.pop(event)) {
+        dispatchEvent(event);
+        dispatchedNb++;
+    }
+}
+
+// Notify the upper layer of a received value
+void KnxDevice::dispatchEvent(const KnxEvent& event) {
+    if ((event.command == KNX_COMMAND_VALUE_WRITE) && !Konnekting.isActive()) return;  // no event routing
+    if (callComObjectFunc(event)) return;
+    if (event.command == KNX_COMMAND_VALUE_RESPONSE) {
+        knxEvents(event.index);
+    } else {
+        //DEBUG_PRINTLN(F("    Routing event to konnektingKnxEvents: #%d"), event.index);
+        konnektingKnxEvents(event.index);
+    }
+}
+
+// Get the callback entry of a com object
+KnxDeviceStatus KnxDevice::comObjectFunc(byte index, KnxComObjectFuncType type, KnxComObjectFunc*& entry) {
+    if (index >= _numberOfComObjects) return KNX_DEVICE_INVALID_INDEX;
+
+    byte format = pgm_read_byte(&KnxDptToFormat[_comObjectsList[index].getDptId()]);
+    switch (type) {
+        case KNX_COMOBJ_FUNC_BOOL:
+            if (format != KNX_DPT_FORMAT_B1) return KNX_DEVICE_NOT_IMPLEMENTED;
+            break;
+        case KNX_COMOBJ_FUNC_WORD:
+            if ((format != KNX_DPT_FORMAT_U16) && (format != KNX_DPT_FORMAT_V16)) return KNX_DEVICE_NOT_IMPLEMENTED;
+            break;
+        case KNX_COMOBJ_FUNC_FLOAT:
+            if (format != KNX_DPT_FORMAT_F16) return KNX_DEVICE_NOT_IMPLEMENTED;  // no F32 conversion (see ConvertFromDpt())
+            break;
+        default:
+            break;
+    }
+
+    if (!_comObjectFuncs) {
+        _comObjectFuncs = (KnxComObjectFunc*)malloc(_numberOfComObjects * sizeof(KnxComObjectFunc));
+        if (!_comObjectFuncs) return KNX_DEVICE_ERROR;
+        for (byte i = 0; i < _numberOfComObjects; i++) _comObjectFuncs[i].type = KNX_COMOBJ_FUNC_NONE;
+    }
+    entry = &_comObjectFuncs[index];
+    return KNX_DEVICE_OK;
+}
+
+// Call the callback of a com object, the value being decoded from the event copy (no read of the com object)
+boolean KnxDevice::callComObjectFunc(const KnxEvent& event) {
+    if (!_comObjectFuncs || (event.index == 255)) return false;
+
+    const KnxComObjectFunc& entry = _comObjectFuncs[event.index];
+    if (entry.type == KNX_COMOBJ_FUNC_NONE) return false;
+    if (entry.type == KNX_COMOBJ_FUNC_INDEX) {
+        entry.func.index(event.index);
+    } else if (event.hasValue) {
+        byte format = pgm_read_byte(&KnxDptToFormat[_comObjectsList[event.index].getDptId()]);
+        word wordValue;
+        float floatValue;
+        switch (entry.type) {
+            case KNX_COMOBJ_FUNC_BOOL:
+                entry.func.boolValue(event.index, event.value[0] != 0);
+                break;
+            case KNX_COMOBJ_FUNC_WORD:
+                if (ConvertFromDpt(event.value, wordValue, format) != KNX_DEVICE_OK) break;  // not decoded, not notified
+                entry.func.wordValue(event.index, wordValue);
+                break;
+            case KNX_COMOBJ_FUNC_FLOAT:
+                if (ConvertFromDpt(event.value, floatValue, format) != KNX_DEVICE_OK) break;  // not decoded, not notified
+                entry.func.floatValue(event.index, floatValue);
+                break;
+        }
+    }
+    return true;
+}
+
+/**
+ * Static getTpUartEvents() function called by the KnxTpUart layer (callback)
+ */
+void KnxDevice::getTpUartEvents(KnxTpUart& tpuart, KnxTpUartEvent event) {
     //DEBUG_PRINTLN(F("KnxDevice::getTpUartEvents"));
 
     switch (event) {
         // Manage RECEIVED MESSAGES
-        case TPUART_EVENT_RECEIVED_KNX_TELEGRAM: {
-            Knx._state = IDLE;
-
-            AddressedComObjects addressedComObjects = Knx._tpuart->getAddressedComObjects();  //.get(0, targetedComObjIndex);
-
-            //DEBUG_PRINTLN(F("  KnxDevice::getTpUartEvents need to process %d comobjs."), addressedComObjects.items);
-
-            // handle all addressed comobjs
-            for (int i = 0; i < addressedComObjects.items; i++) {
-                targetedComObjIndex = addressedComObjects.list[i];
-
-                KnxComObject* comObj = (targetedComObjIndex == 255 ? &Knx._progComObj : &_comObjectsList[targetedComObjIndex]);
-
-                //DEBUG_PRINTLN(F("  KnxDevice::getTpUartEvents targetedComObjIndex=%d command=%d"), targetedComObjIndex, Knx._rxTelegram->getCommand());
-
-                byte indicator = comObj->getIndicator();
-
-                switch (Knx._rxTelegram->getCommand()) {
-                    case KNX_COMMAND_VALUE_READ:
-                        // READ command coming from the bus
-                        // if the Com Object has read attribute, then add RESPONSE action in the TX action list
-                        if ((indicator) & KNX_COM_OBJ_R_INDICATOR) {  // The targeted Com Object can indeed be read
-                            action.command = KNX_RESPONSE_REQUEST;
-                            action.index = targetedComObjIndex;
-                            Knx._txActionList.append(action);
-                        }
-                        break;
-
-                    case KNX_COMMAND_VALUE_RESPONSE:
-                        // RESPONSE command coming from KNX network, we update the value of the corresponding Com Object.
-                        // We 1st check that the corresponding Com Object has UPDATE attribute
-                        if ((indicator) & KNX_COM_OBJ_U_INDICATOR) {
-                            comObj->updateValue(*(Knx._rxTelegram));
-                            //We notify the upper layer of the update
-                            knxEvents(targetedComObjIndex);
-                        }
-                        break;
-
-                    case KNX_COMMAND_VALUE_WRITE:
-                        // WRITE command coming from KNX network, we update the value of the corresponding Com Object.
-                        // We 1st check that the corresponding Com Object has WRITE attribute
-
-                        //DEBUG_PRINTLN(F("  KNX_COMMAND_VALUE_WRITE: ComObj Indicator=0x%02X"), indicator);
-                        if ((indicator) & KNX_COM_OBJ_W_INDICATOR) {
-                            comObj->updateValue(*(Knx._rxTelegram));
-                            //We notify the upper layer of the update
-                            if (Konnekting.isActive()) {
-                                //DEBUG_PRINTLN(F("    Routing event to konnektingKnxEvents: #%d"), targetedComObjIndex);
-                                konnektingKnxEvents(targetedComObjIndex);
-                            } else {
-                                //DEBUG_PRINTLN(F("    No event routing, because not active: #%d"), targetedComObjIndex);
-                                //                        knxEvents(targetedComObjIndex);
-                            }
-                        } else {
-                            //DEBUG_PRINTLN(F(    "Wrong config byte on comobj #%d: 0x%02X"), targetedComObjIndex, indicator);
-                        }
-                        break;
-
-                        // case KNX_COMMAND_MEMORY_WRITE : break; // Memory Write not handled
-
-                    default:
-                        break;  // not supposed to happen
-                }
-            }
+        case TPUART_EVENT_RECEIVED_KNX_TELEGRAM:
+            break;  // the received telegrams are queued by the TPUART and processed in task()
 
-        } break;
         // Manage RESET events
         case TPUART_EVENT_RESET: {
-            while (Knx._tpuart->reset() == KNX_TPUART_ERROR){
+            while (tpuart.reset() == KNX_TPUART_ERROR){
                 // wait for successfull reset
                 //DEBUG_PRINTLN(F("  waiting for reset"));
             }
                 
-            Knx._tpuart->init();
+            tpuart.init();
             Knx._state = IDLE;
         } break;
         // just log unhandled event id
@@ -501,8 +1035,176 @@ void KnxDevice::getTpUartEvents(KnxTpUartEvent event) {
 /*
  * Static txTelegramAck() function called by the KnxTpUart layer (callback)
  */
-void KnxDevice::txTelegramAck(TpUartTxAck) {
-    Knx._state = IDLE;
+void KnxDevice::txTelegramAck(KnxTpUart& tpuart, TpUartTxAck value) {
+    // the telegram sending is over when every line has given its confirm
+    for (byte line = 0; line < Knx._linesNb; line++) {
+        if (Knx._tpuarts[line] == &tpuart) {
+            Knx._pendingAckLines &= ~(1 << line);
+            if (value != ACK_RESPONSE) Knx._failedAckLines |= (1 << line);
+        }
+    }
+    if (!Knx._pendingAckLines) {
+        Knx._state = IDLE;
+        Knx._txDone = true;  // the outcome is handled in task()
+    }
+}
+
+/*
+ * Update the bus load estimation and refill the token buckets of the TX rate limiter (called from task())
+ * The bus load is got from the bytes seen by the TPUARTs (i.e. all the telegrams on the bus), minus the bytes we sent,
+ * and the limited rates are reduced as much as the bus is loaded by the other devices
+ */
+void KnxDevice::updateTxRateLimiter(word nowTimeMillis) {
+    word elapsed = TimeDeltaWord(nowTimeMillis, _lastBusLoadTimeMillis);
+    if (elapsed >= KNX_BUS_LOAD_PERIOD_MS) {
+        byte load = 0;
+        for (byte line = 0; line < _linesNb; line++) {
+            word bytesNb = _tpuarts[line]->getBusBytesNb();
+            word seenNb = bytesNb - _busBytesNb[line];
+            _busBytesNb[line] = bytesNb;
+            seenNb = (seenNb > _ownBusBytesNb ? seenNb - _ownBusBytesNb : 0);
+            unsigned long lineLoad = (unsigned long)seenNb * KNX_BUS_BYTE_TIME_US / ((unsigned long)elapsed * 10);
+            if (lineLoad > load) load = (lineLoad > 100 ? 100 : (byte)lineLoad);
+        }
+        _busLoad = load;
+        _ownBusBytesNb = 0;
+        _lastBusLoadTimeMillis = nowTimeMillis;
+    }
+
+    elapsed = TimeDeltaWord(nowTimeMillis, _lastTokenTimeMillis);
+    if (!elapsed) return;
+    _lastTokenTimeMillis = nowTimeMillis;
+    byte share = (_busLoad < 100 - KNX_TX_RATE_MIN_SHARE ? 100 - _busLoad : KNX_TX_RATE_MIN_SHARE);
+    for (byte level = 0; level < KNX_TX_LEVELS_NB; level++) {
+        if (!_txRate[level]) continue;
+        // 1000 tokens per telegram, so rate tokens per msec
+        unsigned long tokens = _txTokens[level] + (unsigned long)elapsed * _txRate[level] * share / 100;
+        _txTokens[level] = (tokens > _txBurst[level] * 1000UL ? _txBurst[level] * 1000 : (word)tokens);
+    }
+}
+
+/*
+ * Returns the TX queue levels which have a token to send a telegram (the levels without rate limit always have one)
+ */
+byte KnxDevice::allowedTxLevels(void) const {
+    byte levels = 0;
+    for (byte level = 0; level < KNX_TX_LEVELS_NB; level++) {
+        if (!_txRate[level] || (_txTokens[level] >= 1000)) levels |= (1 << level);
+    }
+    return levels;
+}
+
+/*
+ * Handle the outcome of the current TX telegram (called from task() once every line has given its confirm)
+ * A failed telegram is moved to a free retry slot if its priority allows a further retry, else the final result is reported
+ * NB : a telegram with retries is only sent when a retry slot is free (see isTxNextAllowed()), and a retry frees its own slot
+ */
+void KnxDevice::handleTxOutcome(void) {
+    byte swapped;
+    byte attempts = _txAttempts[_txCurrent];
+
+    _txDone = false;
+    if (_failedAckLines && (_txRetryNb < KNX_TX_RETRY_SLOTS)
+        && (attempts <= _txMaxRetries[KnxTxLevel(_txTelegrams[_txCurrent].getPriority())])) {
+        DEBUG_PRINTLN(F("TX failed for comobj %d, retry %d"), _txObjIndex[_txCurrent], attempts);
+        swapped = _txRetry[_txRetryNb]; _txRetry[_txRetryNb++] = _txCurrent; _txCurrent = swapped;
+        _txRetryLines[_txRetry[_txRetryNb - 1]] = _failedAckLines;
+        // exponential backoff, saturated to the word max
+        unsigned long wait = (unsigned long)_txRetryBackoff << (attempts > 8 ? 8 : attempts - 1);
+        _txRetryWait[_txRetry[_txRetryNb - 1]] = (wait > 0xFFFF ? 0xFFFF : (word)wait);
+    } else if (_txResultFunc) {
+        _txResultFunc(_txObjIndex[_txCurrent], (_failedAckLines ? KNX_TX_RESULT_FAILED : KNX_TX_RESULT_OK));
+    }
+    _failedAckLines = 0;
+}
+
+/*
+ * Returns the retry slot of the first telegram (in failure order) whose backoff is over, _txRetryNb if there's none
+ */
+byte KnxDevice::getTxRetryReady(void) const {
+    byte slot = 0;
+    while ((slot < _txRetryNb) && _txRetryWait[_txRetry[slot]]) slot++;
+    return slot;
+}
+
+/*
+ * Returns true if the next TX telegram can be sent : a telegram which may be retried needs a free retry slot,
+ * so that it gets its retries if it fails (it then waits for a retry to be over)
+ */
+boolean KnxDevice::isTxNextAllowed(void) const {
+    if (_txRetryNb < KNX_TX_RETRY_SLOTS) return true;
+    return !_txMaxRetries[KnxTxLevel(_txTelegrams[_txNext].getPriority())];
+}
+
+/*
+ * Perform a TX action popped from the queue and build its telegram
+ * Returns false if there's no telegram to send (WRITE of a com object without transmit attribute)
+ */
+boolean KnxDevice::encodeTxAction(const TxAction& action, KnxTelegram& telegram) {
+    //DEBUG_PRINTLN(F("Data to be transmitted index=%d"), action.index);
+    KnxComObject* comObj = (action.index == 255 ? &_progComObj : &_comObjectsList[action.index]);
+
+    switch (action.command) {
+
+        case KNX_READ_REQUEST: // a read operation of a Com Object on the KNX network is required
+            comObj->copyAttributes(telegram);
+            telegram.clearLongPayload();
+            telegram.clearFirstPayloadByte(); // Is it required to have a clean payload ??
+            telegram.setCommand(KNX_COMMAND_VALUE_READ);
+            telegram.updateChecksum();
+            return true;
+
+        case KNX_RESPONSE_REQUEST: // a response operation of a Com Object on the KNX network is required
+            comObj->copyAttributes(telegram);
+            comObj->copyValue(telegram);
+            telegram.setCommand(KNX_COMMAND_VALUE_RESPONSE);
+            telegram.updateChecksum();
+            return true;
+
+        case KNX_WRITE_REQUEST: // a write operation of a Com Object on the KNX network is required
+            comObj->setPendingTxSlot(KNX_TX_QUEUE_NONE);  // the action is no longer in the queue
+            // update the com obj value
+            if ((comObj->getLength()) <= 2) {
+                comObj->updateValue(action.byteValue);
+            } else {
+                comObj->updateValue(action.longValue);
+            }
+            // transmit the value through KNX network only if the Com Object has transmit attribute
+            if ((comObj->getIndicator()) & KNX_COM_OBJ_T_INDICATOR) {
+                comObj->copyAttributes(telegram);
+                comObj->copyValue(telegram);
+                telegram.setCommand(KNX_COMMAND_VALUE_WRITE);
+                telegram.updateChecksum();
+                return true;
+            }
+            return false;
+
+        default: return false;
+    }
+}
+
+/*
+ * Send the current TX telegram on the given lines
+ */
+void KnxDevice::sendTxTelegram(byte lines) {
+    _ownBusBytesNb += _txTelegrams[_txCurrent].getTelegramLength();
+    for (byte line = 0; line < _linesNb; line++) {
+        if (!(lines & (1 << line))) continue;
+        if (_tpuarts[line]->sendTelegram(_txTelegrams[_txCurrent]) == KNX_TPUART_OK) _pendingAckLines |= (1 << line);
+        else _failedAckLines |= (1 << line);
+    }
+    if (_pendingAckLines) _state = TX_ONGOING;
+    else _txDone = true;  // not sent at all
+}
+
+/*
+ * Returns true if there's RX/TX activity on at least one line
+ */
+bool KnxDevice::isLineActive(void) const {
+    for (byte line = 0; line < _linesNb; line++) {
+        if (_tpuarts[line]->isActive()) return true;
+    }
+    return false;
 }
 
 template <typename T>
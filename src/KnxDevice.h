@@ -21,9 +21,10 @@
 #include "Arduino.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
-#include "RingBuff.h"
+#include "KnxTxQueue.h"
 #include "KnxTpUart.h"
 #include "KonnektingDevice.h"
+#include "RingBuff.h"
 
 // !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
 // DEBUG :
@@ -35,10 +36,24 @@ enum KnxDeviceStatus {
   KNX_DEVICE_INVALID_INDEX = 1,
   KNX_DEVICE_INIT_ERROR = 2,
   KNX_DEVICE_COMOBJ_INACTIVE = 3,
+  KNX_DEVICE_TX_QUEUE_FULL = 4,
   KNX_DEVICE_NOT_IMPLEMENTED = 254,
   KNX_DEVICE_ERROR = 255
 };
 
+// Behaviour of the TX action queue when it is full
+enum KnxTxOverflowPolicy {
+  KNX_TX_OVERFLOW_DROP_OLDEST = 0, // the oldest action of the lowest priority is dropped (default)
+  KNX_TX_OVERFLOW_REJECT_NEW = 1,  // the new action is rejected
+  KNX_TX_OVERFLOW_COALESCE = 2     // the new action replaces the queued one of the same type for the same com object, else it is rejected
+};
+
+// Final outcome of a telegram sending, given to the TX result function
+enum KnxTxResult {
+  KNX_TX_RESULT_OK = 0,    // the telegram has been confirmed by every line
+  KNX_TX_RESULT_FAILED = 1 // NACK, no answer or TPUART reset on at least one line, and no retry left
+};
+
 // Macro functions for conversion of physical and group addresses
 inline word P_ADDR(byte area, byte line, byte busdevice)
 { return (word) ( ((area&0xF)<<12) + ((line&0xF)<<8) + busdevice ); }
@@ -46,7 +61,84 @@ inline word P_ADDR(byte area, byte line, byte busdevice)
 inline word G_ADDR(byte maingrp, byte midgrp, byte subgrp)
 { return (word) ( ((maingrp&0x1F)<<11) + ((midgrp&0x7)<<8) + subgrp ); }
 
-#define ACTIONS_QUEUE_SIZE 16
+// Max number of KNX lines (i.e. TPUARTs) driven by the device
+#ifndef KNX_DEVICE_MAX_LINES
+#define KNX_DEVICE_MAX_LINES 2
+#endif
+#if (KNX_DEVICE_MAX_LINES < 1) || (KNX_DEVICE_MAX_LINES > 8)
+#error "KNX_DEVICE_MAX_LINES shall be in 1..8"
+#endif
+
+// Default base of the TX retry backoff (in msec of bus idle time), doubled at each retry
+#ifndef KNX_TX_RETRY_BACKOFF_MS
+#define KNX_TX_RETRY_BACKOFF_MS 50
+#endif
+
+// Nb of TX telegrams which can wait for a retry at the same time (1 to 8)
+// NB : a telegram with retries is not sent while all the slots are taken, so that it gets its retries if it fails
+#ifndef KNX_TX_RETRY_SLOTS
+#define KNX_TX_RETRY_SLOTS 2
+#endif
+#if (KNX_TX_RETRY_SLOTS < 1) || (KNX_TX_RETRY_SLOTS > 8)
+#error "KNX_TX_RETRY_SLOTS shall be in 1..8"
+#endif
+
+// Period (in msec) of the bus load estimation
+#ifndef KNX_BUS_LOAD_PERIOD_MS
+#define KNX_BUS_LOAD_PERIOD_MS 1000
+#endif
+
+// Bus time (in usec) of a telegram byte : 13 bits (start, 8 data, parity, stop and 2 bits pause) at 9600 bit/s
+#define KNX_BUS_BYTE_TIME_US 1354
+
+// Min share (in %) of the limited TX rates which is kept when the bus is fully loaded by the other devices
+#ifndef KNX_TX_RATE_MIN_SHARE
+#define KNX_TX_RATE_MIN_SHARE 10
+#endif
+
+// Max burst of the TX rate limiter (the tokens are counted in 1/1000 telegram in a word)
+#define KNX_TX_RATE_MAX_BURST 65
+
+// Max nb of Init READ requests waiting for their response at the same time
+#ifndef KNX_INIT_READS_MAX
+#define KNX_INIT_READS_MAX 4
+#endif
+
+// Time (in msec) to wait for the response to an Init READ request before sending it again
+#ifndef KNX_INIT_READ_TIMEOUT_MS
+#define KNX_INIT_READ_TIMEOUT_MS 2000
+#endif
+
+// Nb of Init READ requests sent for a com object before giving up
+#ifndef KNX_INIT_READ_ATTEMPTS
+#define KNX_INIT_READ_ATTEMPTS 3
+#endif
+
+// Min time (in msec) between 2 new Init READ requests, to avoid KNX bus overloading
+#ifndef KNX_INIT_READ_INTERVAL_MS
+#define KNX_INIT_READ_INTERVAL_MS 500
+#endif
+
+// When set to 1, task() stays until the RX/TX activity of every line is over
+// When set to 0, task() returns after each pass, and the returned deadline tells when it shall be called again
+#ifndef KNX_DEVICE_TASK_BLOCKING
+#define KNX_DEVICE_TASK_BLOCKING 1
+#endif
+
+// Periods (in usec) of the TPUART RX and TX tasks
+#define KNX_DEVICE_RX_PERIOD_US 400
+#define KNX_DEVICE_TX_PERIOD_US 800
+
+// Value returned by nextDeadline() when task() can wait for an interrupt (e.g. UART RX)
+#define KNX_DEVICE_NO_DEADLINE 0xFFFFFFFF
+
+// Nb of received value events kept until they are dispatched at the end of task()
+#ifndef KNX_DEVICE_EVENTS_NB
+#define KNX_DEVICE_EVENTS_NB 8
+#endif
+
+// Nb of TX telegram buffers : current, next and one per retry slot
+#define KNX_TX_TELEGRAMS_NB (2 + KNX_TX_RETRY_SLOTS)
 
 // KnxDevice internal state
 enum InternalDeviceState {
@@ -55,26 +147,34 @@ enum InternalDeviceState {
   TX_ONGOING,
 };
 
-// Action types
-enum TxActionType {
-  KNX_READ_REQUEST,
-  KNX_WRITE_REQUEST,
-  KNX_RESPONSE_REQUEST
-};
 
-typedef struct TxAction{
-  TxActionType command; // Action type to be performed
-  byte index; // Index of the involved ComObject
-  union { // Value
-    // Field used in case of short value (value width <= 1 byte)
-    struct {
-      byte byteValue;
-      byte notUsed;
-    };
-    byte *valuePtr; // Field used in case of long value (width > 1 byte), space is allocated dynamically
-  };
-} TxAction;
+// Received value event, dispatched to knxEvents() at the end of task()
+typedef struct KnxEvent {
+  byte index;                           // Com object index
+  e_KnxCommand command;                 // KNX_COMMAND_VALUE_RESPONSE or KNX_COMMAND_VALUE_WRITE
+  boolean hasValue;                     // False if the telegram payload length differs from the com object one
+  byte value[KNX_TX_ACTION_VALUE_SIZE]; // Copy of the received value, com object format
+} KnxEvent;
 
+// Types of the callbacks registered per com object
+enum KnxComObjectFuncType {
+  KNX_COMOBJ_FUNC_NONE = 0,
+  KNX_COMOBJ_FUNC_INDEX,    // void func(byte index)
+  KNX_COMOBJ_FUNC_BOOL,     // void func(byte index, bool value), 1 bit com objects
+  KNX_COMOBJ_FUNC_WORD,     // void func(byte index, word value), U16 and V16 com objects
+  KNX_COMOBJ_FUNC_FLOAT     // void func(byte index, float value), F16 (DPT 9) com objects
+};
+
+// Callback registered for a com object
+typedef struct KnxComObjectFunc {
+  byte type;                            // KnxComObjectFuncType
+  union {
+    void (*index)(byte);
+    void (*boolValue)(byte, bool);
+    void (*wordValue)(byte, word);
+    void (*floatValue)(byte, float);
+  } func;
+} KnxComObjectFunc;
 
 // Callback function to catch and treat KNX events
 // The definition shall be provided by the end-user
@@ -106,17 +206,42 @@ class KnxDevice {
     // Current KnxDevice state
     InternalDeviceState _state;  
     
-    // TPUART associated to the KNX Device
-    KnxTpUart *_tpuart;                             
+    // TPUARTs associated to the KNX Device, one per line (line 0 is started by begin())
+    KnxTpUart *_tpuarts[KNX_DEVICE_MAX_LINES];
+    
+    // Nb of driven lines
+    byte _linesNb;
     
-    // Queue of transmit actions to be performed
-    RingBuff<TxAction, ACTIONS_QUEUE_SIZE> _txActionList; 
+    // Lines (bit i for line i) the sent telegram is still waiting the confirm from
+    byte _pendingAckLines;
+    
+    // Queue of transmit actions to be performed, one FIFO per priority
+    KnxTxQueue _txActionList; 
     
     // True when all the Com Object with Init attr have been initialized
     bool _initCompleted;                         
     
-    // Index to the last initiated object
-    byte _initIndex;                                
+    // True when a WRITE of a com object updates its pending WRITE action (if any) instead of being queued
+    bool _txCoalescing;
+    
+    // What to do when the TX action queue is full
+    KnxTxOverflowPolicy _txOverflowPolicy;
+    
+    // Nb of TX actions lost because the queue was full (dropped or rejected)
+    word _txDroppedNb;
+    
+    // Indexes of the Com Objects to be initialized, built on the first init step (NULL before)
+    byte* _initList;
+    
+    // Nb of indexes in the init list, and position of the next one to be read
+    byte _initListNb;
+    byte _initListHead;
+    
+    // Init READ requests waiting for their response : com object index (255 for a free slot),
+    // time (in msec) of the last request and nb of requests sent
+    byte _initReadIndex[KNX_INIT_READS_MAX];
+    word _initReadTime[KNX_INIT_READS_MAX];
+    byte _initReadAttempts[KNX_INIT_READS_MAX];
     
     // Time (in msec) of the last init (read) request on the bus
     word _lastInitTimeMillis;                       
@@ -127,11 +252,79 @@ class KnxDevice {
     // Time (in msec) of the last Tpuart Tx activity;
     word _lastTXTimeMicros;                         
     
-    // Telegram object used for telegrams sending
-    KnxTelegram _txTelegram;                        
+    // Telegram objects used for telegrams sending : the current one is being sent by the TPUARTs,
+    // the next one is built in advance, the retry ones wait for the end of their backoff
+    KnxTelegram _txTelegrams[KNX_TX_TELEGRAMS_NB];
+    
+    // Index in _txTelegrams of the current and next TX telegrams, and of the retry slots :
+    // the _txRetryNb first slots hold the telegrams waiting for a retry (in failure order), the other ones are free
+    byte _txCurrent;
+    byte _txNext;
+    byte _txRetry[KNX_TX_RETRY_SLOTS];
+    byte _txRetryNb;
+    
+    // Com Object index and nb of sendings of each TX telegram
+    byte _txObjIndex[KNX_TX_TELEGRAMS_NB];
+    byte _txAttempts[KNX_TX_TELEGRAMS_NB];
+    
+    // Lines (bit i for line i) to send each retry telegram on, and remaining bus idle time before its retry (in msec)
+    byte _txRetryLines[KNX_TX_TELEGRAMS_NB];
+    word _txRetryWait[KNX_TX_TELEGRAMS_NB];
+    
+    // True when the next TX telegram is built and waits for the current one to be confirmed
+    bool _txNextReady;
+    
+    // True when the current TX telegram has been confirmed by every line and its outcome is not handled yet
+    bool _txDone;
+    
+    // Lines (bit i for line i) which haven't acknowledged the current TX telegram
+    byte _failedAckLines;
+    
+    // Max nb of retries of a TX telegram, per TX queue level
+    byte _txMaxRetries[KNX_TX_LEVELS_NB];
+    
+    // Base of the retry backoff (in msec)
+    word _txRetryBackoff;
+    
+    // Time (in msec) of the last retry backoff update
+    word _lastRetryTimeMillis;
+    
+    // Optional function called with the final outcome of each telegram sending
+    void (*_txResultFunc)(byte, KnxTxResult);
+    
+    // Token buckets limiting the rate of the sent telegrams, per TX queue level (no limit when the rate is 0)
+    byte _txRate[KNX_TX_LEVELS_NB];   // telegrams per second
+    byte _txBurst[KNX_TX_LEVELS_NB];  // bucket size, in telegrams
+    word _txTokens[KNX_TX_LEVELS_NB]; // available tokens, in 1/1000 telegram
+    
+    // Time (in msec) of the last token buckets refill
+    word _lastTokenTimeMillis;
     
-    // Reference to the telegram received by the TPUART
-    KnxTelegram *_rxTelegram;                       
+    // Estimated load (in %) of the busiest line by the other devices, over the last KNX_BUS_LOAD_PERIOD_MS
+    byte _busLoad;
+    
+    // Nb of bytes seen by each TPUART, and nb of bytes sent by the device, at the start of the bus load period
+    word _busBytesNb[KNX_DEVICE_MAX_LINES];
+    word _ownBusBytesNb;
+    
+    // Time (in msec) of the start of the bus load period
+    word _lastBusLoadTimeMillis;
+    
+    // Longest time (in usec) spent in a task() call
+    unsigned long _taskMaxDurationMicros;
+    
+    // Received value events waiting to be dispatched, and max nb of events dispatched per task() call (0 : no limit)
+    RingBuff<KnxEvent, KNX_DEVICE_EVENTS_NB> _events;
+    byte _eventDispatchLimit;
+    
+    // Callbacks of the com objects, indexed by com object (NULL until the first registration)
+    KnxComObjectFunc* _comObjectFuncs;
+    
+    // Com objects updated from the bus and not yet got by nextChanged(), one bit per com object (allocated on begin())
+    uint32_t* _changedComObjects;
+    
+    // Optional ring fed by the UART RX interrupt, attached to the TPUART on begin()
+    KnxRxRing *_rxRing;                             
     
     // Constructor, Destructor
     // private constructor (singleton design pattern)
@@ -156,6 +349,23 @@ class KnxDevice {
      */
     KnxDeviceStatus begin(HardwareSerial& serial, word physicalAddr);
 
+    /*
+     * Set the ring fed by the UART RX interrupt (NULL to come back to serial polling)
+     * The ring is attached to the TPUART on begin(), so this function shall be called before begin()
+     * NB : the UART RX interrupt routine shall call ring.push(byte) for every received byte
+     */
+    void setRxRing(KnxRxRing* ring);
+
+    /*
+     * Add a KNX line driven by a further TPUART, with the same physical address as the one given to begin()
+     * The telegrams received on every line are processed, and the telegrams are sent on every line
+     * This function shall be called after begin()
+     * return KNX_DEVICE_INIT_ERROR (2) if begin() has not been called or if the TPUART reset failed
+     * return KNX_DEVICE_ERROR (255) if KNX_DEVICE_MAX_LINES lines are already driven
+     * else return KNX_DEVICE_OK
+     */
+    KnxDeviceStatus addLine(HardwareSerial& serial, KnxRxRing* ring = NULL);
+
     /*
      * Stop the KNX Device
      */ 
@@ -164,8 +374,26 @@ class KnxDevice {
     /*
      * KNX device execution task
      * This function shall be called in the "loop()" Arduino function
+     * return the time (in usec) before it shall be called again (see nextDeadline())
+     */
+    unsigned long task(void);
+
+    /*
+     * KNX device execution task, cooperative mode
+     * The RX/TX state machines are advanced step by step while a line is active, and the function returns
+     * as soon as the time budget (in usec) is spent or the next deadline is beyond it
+     * NB : no byte is lost as long as task() is called again before the UART buffer (or RX ring) is full
+     * return the time (in usec) before it shall be called again (see nextDeadline())
      */
-    void task(void);
+    unsigned long task(word budgetMicros);
+
+    /*
+     * Time (in usec) before task() shall be called, 0 if there's work to do right now
+     * The sketch may sleep or run its own work meanwhile
+     * return KNX_DEVICE_NO_DEADLINE if task() only has to be called on interrupt
+     * (i.e. a byte received in the RX ring, see setRxRing()) or after a com object update
+     */
+    unsigned long nextDeadline(void) const;
 
     /* 
      * Quick method to read a short (<=1 byte) com object
@@ -187,6 +415,7 @@ class KnxDevice {
     // Update com object functions :
     // For all the update functions, the com object value is updated locally
     // and a telegram is sent on the KNX bus if the object has both COMMUNICATION & TRANSMIT attributes set
+    // KNX_DEVICE_TX_QUEUE_FULL is returned if the TX action queue is full and the WRITE cannot be queued
 
     /*
      * Update an usual format com object
@@ -198,14 +427,23 @@ class KnxDevice {
      * Update any type of com object (rough DPT value shall be provided)
      */
     KnxDeviceStatus write(byte objectIndex, byte valuePtr[]);
+
+    /*
+     * Set a com object value restored from a persistent storage (rough DPT value shall be provided)
+     * The value is updated locally only, nothing is sent on the bus,
+     * and the com object is no longer initialized by an Init READ request
+     */
+    KnxDeviceStatus restoreValue(byte objectIndex, const byte valuePtr[]);
     
 
     /*
      * Com Object KNX Bus Update request
      * Request the local object to be updated with the value from the bus
      * NB : the function is asynchroneous, the update completion is notified by the knxEvents() callback
+     * return KNX_DEVICE_TX_QUEUE_FULL (4) if the TX action queue is full and the request cannot be queued
+     * else return KNX_DEVICE_OK
      */
-    void update(byte objectIndex);
+    KnxDeviceStatus update(byte objectIndex);
 
     
     /**
@@ -216,6 +454,99 @@ class KnxDevice {
         
     KnxDeviceStatus setComObjectIndicator(byte index, byte indicator);
     KnxDeviceStatus setComObjectAddress(byte index, word addr);
+
+    /*
+     * Register the function notified instead of knxEvents() when the com object is updated from the bus
+     * The typed variants get the decoded value : bool for 1 bit com objects, word for U16 and V16 ones,
+     * float for F16 (DPT 9) ones (they are not notified of a telegram whose length doesn't match)
+     * A NULL function restores the knxEvents() notification
+     * return KNX_DEVICE_INVALID_INDEX, KNX_DEVICE_NOT_IMPLEMENTED if the com object format doesn't fit the value type,
+     * KNX_DEVICE_ERROR if the callback table cannot be allocated, else KNX_DEVICE_OK
+     */
+    KnxDeviceStatus setComObjectCallback(byte index, void (*func)(byte));
+    KnxDeviceStatus setComObjectCallback(byte index, void (*func)(byte, bool));
+    KnxDeviceStatus setComObjectCallback(byte index, void (*func)(byte, word));
+    KnxDeviceStatus setComObjectCallback(byte index, void (*func)(byte, float));
+
+    /*
+     * Get the first com object updated from the bus (WRITE or RESPONSE) since it was last got, from startIndex on
+     * The com object is then no longer marked as changed, so the changed ones can be polled in a loop :
+     * for (int i = Knx.nextChanged(0); i >= 0; i = Knx.nextChanged(i + 1)) { ... }
+     * return -1 if no com object has changed
+     */
+    int nextChanged(int startIndex);
+
+    /*
+     * Set the KNX priority of the telegrams sent for a com object
+     * The TX actions of higher priority are sent first (SYSTEM, ALARM, HIGH then NORMAL)
+     */
+    KnxDeviceStatus setComObjectPriority(byte index, e_KnxPriority priority);
+
+    /*
+     * Set the TX coalescing mode (off by default)
+     * When on, the write of a com object whose previous WRITE is still waiting in the TX queue
+     * updates the waiting action with the new value, so only the last value is sent
+     * NB : the programming com object is never coalesced
+     */
+    void setTxCoalescing(bool coalescing);
+
+    /*
+     * Set the behaviour of the TX action queue when it is full (KNX_TX_OVERFLOW_DROP_OLDEST by default)
+     * With KNX_TX_OVERFLOW_REJECT_NEW or KNX_TX_OVERFLOW_COALESCE, write() and update() return
+     * KNX_DEVICE_TX_QUEUE_FULL instead of dropping an action, so the application can retry later
+     */
+    void setTxOverflowPolicy(KnxTxOverflowPolicy policy);
+
+    /*
+     * Set the max nb of retries of the telegrams of a KNX priority (0 by default, i.e. no retry)
+     * A telegram which got a NACK, no answer or a TPUART reset on a line is sent again on that line
+     * once the bus has been idle for the backoff time, the other TX actions being sent meanwhile
+     * Up to KNX_TX_RETRY_SLOTS telegrams wait for a retry at the same time, each one with its own backoff
+     */
+    void setTxRetries(e_KnxPriority priority, byte retries);
+
+    /*
+     * Set the backoff before the first retry, in msec of bus idle time (KNX_TX_RETRY_BACKOFF_MS by default)
+     * The backoff is doubled at each further retry
+     */
+    void setTxRetryBackoff(word backoffMillis);
+
+    /*
+     * Set the function called with the final outcome of each telegram sending (com object index, result)
+     */
+    void setTxResultFunc(void (*func)(byte, KnxTxResult));
+
+    /*
+     * Limit the rate of the telegrams of a KNX priority (token bucket), 0 telegrams per second for no limit (default)
+     * Up to burst telegrams (1..KNX_TX_RATE_MAX_BURST) can be sent in a row after an idle period
+     * The rate is reduced as the bus load by the other devices increases, down to KNX_TX_RATE_MIN_SHARE %
+     * NB : the retries are not limited
+     */
+    void setTxRateLimit(e_KnxPriority priority, byte telegramsPerSecond, byte burst = 1);
+
+    /*
+     * Get the estimated load (in %) of the busiest line by the other devices
+     */
+    byte getBusLoad(void) const { return _busLoad; }
+
+    /*
+     * TX action queue statistics : max nb of queued actions, and nb of actions lost because the queue was full
+     */
+    byte getTxQueueHighWaterMark(void) const { return _txActionList.getMaxItemCount(); }
+    word getTxDroppedNb(void) const { return _txDroppedNb; }
+    void resetTxQueueStats(void);
+
+    /*
+     * Get the longest time (in usec) spent in a task() call since begin() or the last reset
+     */
+    unsigned long getTaskMaxDuration(void) const { return _taskMaxDurationMicros; }
+    void resetTaskMaxDuration(void) { _taskMaxDurationMicros = 0; }
+
+    /*
+     * Set the max nb of received value events dispatched to knxEvents() per task() call (0 : no limit, default)
+     * The other events wait for the next task() calls
+     */
+    void setEventDispatchLimit(byte limit) { _eventDispatchLimit = limit; }
     
     /*
      *  Gets the address of an commobjects
@@ -223,15 +554,135 @@ class KnxDevice {
     word getComObjectAddress(byte index);
     
   private:
+    /*
+     * Run one step of the KNX device task : init, RX, TX
+     */
+    void taskStep(void);
+
+    /*
+     * Send the Init READ requests of the com objects with Init attribute, and follow their responses
+     */
+    void initTask(word nowTimeMillis);
+
+    /*
+     * Build the list of the com objects to be initialized
+     */
+    void buildInitList(void);
+
+    /*
+     * Process a telegram received by the TPUART
+     */
+    void processReceivedTelegram(KnxTelegram& telegram);
+
+    /*
+     * Update the com object with the received value right away (so that a READ gets the new value),
+     * and queue the event to notify the upper layer
+     */
+    void receiveValue(const KnxTelegram& telegram, byte index, KnxComObject& comObj);
+
+    /*
+     * Queue a received value event, to be dispatched at the end of task()
+     * The events of the programming com object are dispatched right away, as are the oldest ones when the ring is full
+     */
+    void queueEvent(const KnxEvent& event);
+
+    /*
+     * Dispatch the queued events, within the dispatch limit
+     */
+    void dispatchEvents(void);
+
+    /*
+     * Notify the upper layer of a received value (the com object is already updated)
+     */
+    void dispatchEvent(const KnxEvent& event);
+
+    /*
+     * Get the callback entry of a com object, after checking its format (KnxDptFormat)
+     * The callback table is allocated on the first call
+     * return KNX_DEVICE_OK and the entry, else the error to be returned by setComObjectCallback()
+     */
+    KnxDeviceStatus comObjectFunc(byte index, KnxComObjectFuncType type, KnxComObjectFunc*& entry);
+
+    /*
+     * Call the callback of a com object with the decoded value of the event
+     * return false if no callback is registered for the com object
+     */
+    boolean callComObjectFunc(const KnxEvent& event);
+
+    /*
+     * Queue a TX action in the FIFO of its com object priority
+     * When the queue is full, the TX overflow policy applies
+     * In TX coalescing mode, a WRITE updates the pending WRITE of the com object, if any
+     * return KNX_DEVICE_TX_QUEUE_FULL if the action is rejected, else KNX_DEVICE_OK
+     */
+    KnxDeviceStatus queueTxAction(const TxAction& action);
+
+    /*
+     * Create, reset and init the TPUART of a new line
+     */
+    KnxDeviceStatus startLine(HardwareSerial& serial, word physicalAddr, KnxRxRing* ring);
+
+    /*
+     * Delete the TPUARTs of all the lines
+     */
+    void deleteLines(void);
+
+    /*
+     * Place the values of the programming com object and of the com object table in the value arena, once
+     * return false if there's no memory for them
+     */
+    boolean placeComObjectValues(void);
+
+    /*
+     * Perform a TX action popped from the queue and build its telegram
+     * return false if there's no telegram to send (WRITE of a com object without transmit attribute)
+     */
+    boolean encodeTxAction(const TxAction& action, KnxTelegram& telegram);
+
+    /*
+     * Update the bus load estimation and refill the token buckets of the TX rate limiter
+     */
+    void updateTxRateLimiter(word nowTimeMillis);
+
+    /*
+     * Returns the TX queue levels (bit i for level i) which have a token to send a telegram
+     */
+    byte allowedTxLevels(void) const;
+
+    /*
+     * Handle the outcome of the current TX telegram : keep it for a retry or report the final result
+     */
+    void handleTxOutcome(void);
+
+    /*
+     * Returns the retry slot of the first telegram whose backoff is over, _txRetryNb if there's none
+     */
+    byte getTxRetryReady(void) const;
+
+    /*
+     * Returns true if the next TX telegram can be sent, i.e. its priority has no retries or a retry slot is free
+     */
+    boolean isTxNextAllowed(void) const;
+
+    /*
+     * Send the current TX telegram on the given lines (bit i for line i)
+     */
+    void sendTxTelegram(byte lines);
+
+    /*
+     * Returns true if there's RX/TX activity on at least one line
+     */
+    bool isLineActive(void) const;
+
     /*
      * Static getTpUartEvents() function called by the KnxTpUart layer (callback)
      */
-    static void getTpUartEvents(KnxTpUartEvent event);
+    static void getTpUartEvents(KnxTpUart& tpuart, KnxTpUartEvent event);
 
     /* 
      * Static txTelegramAck() function called by the KnxTpUart layer (callback)
      */
-    static void txTelegramAck(TpUartTxAck);
+    static void txTelegramAck(KnxTpUart& tpuart, TpUartTxAck);
     
 };
 
@@ -0,0 +1,153 @@
+/*
+ *    This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KNXRXRING_H
+#define KNXRXRING_H
+
+#include "Arduino.h"
+
+// Size of the RX ring (nb of bytes), shall be a power of 2 not greater than 256
+#ifndef KNX_RX_RING_SIZE
+#define KNX_RX_RING_SIZE 64
+#endif
+
+#if (KNX_RX_RING_SIZE > 256) || (KNX_RX_RING_SIZE & (KNX_RX_RING_SIZE - 1))
+#error "KNX_RX_RING_SIZE shall be a power of 2 not greater than 256"
+#endif
+
+#define KNX_RX_RING_MASK (KNX_RX_RING_SIZE - 1)
+
+// Memory barrier between the byte accesses and the index update (publish / release order)
+// A compiler barrier is enough on single core AVR, ARM cores also get a data memory barrier
+#if defined(__arm__)
+#define KNX_RX_RING_BARRIER() __asm__ __volatile__ ("dmb" ::: "memory")
+#else
+#define KNX_RX_RING_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+#endif
+
+/**
+ * Lock-free single producer / single consumer ring of timestamped bytes
+ * 
+ * The producer is the UART RX interrupt routine: it calls push() for each received byte,
+ * the byte is timestamped with micros() at interrupt time.
+ * The consumer is KnxTpUart::rxTask() which pops (byte, timestamp) pairs,
+ * so that the End Of Packet detection relies on the real gaps between the bytes on the bus.
+ * 
+ * Only the producer writes _tail and only the consumer writes _head, 
+ * both are single bytes so that no lock (no interrupt masking) is required.
+ * A barrier orders the content accesses with the index updates : the producer writes the byte before publishing
+ * the new _tail, the consumer reads _tail before the byte and releases the slot once the byte is read.
+ * When the ring is full, the new byte is dropped and the overflow counter is incremented.
+ */
+class KnxRxRing {
+    volatile byte _head;                              // next slot to be read (written by the consumer only)
+    volatile byte _tail;                              // next slot to be written (written by the producer only)
+    volatile byte _data[KNX_RX_RING_SIZE];            // received bytes
+    volatile word _timestamp[KNX_RX_RING_SIZE];       // reception time (in usec) of each byte
+    volatile byte _overflowCount;                     // Nb of bytes lost because the ring was full (saturated at 255)
+
+public:
+
+    /**
+     * Constructor
+     */
+    KnxRxRing() {
+        _head = 0;
+        _tail = 0;
+        _overflowCount = 0;
+    };
+
+    /**
+     * Push a received byte, timestamped with the current time
+     * To be called from the UART RX interrupt routine only (producer side)
+     * @param data the received byte
+     */
+    inline void push(byte data) {
+        push(data, (word)micros());
+    }
+
+    /**
+     * Push a received byte with its reception time
+     * To be called from the UART RX interrupt routine only (producer side)
+     * @param data the received byte
+     * @param timestamp reception time of the byte (in usec)
+     * @return false if the ring is full (the byte is lost)
+     */
+    inline boolean push(byte data, word timestamp) {
+        byte tail = _tail;
+        byte next = (tail + 1) & KNX_RX_RING_MASK;
+        if (next == _head) { // ring full
+            if (_overflowCount < 255) _overflowCount++;
+            return false;
+        }
+        _data[tail] = data;
+        _timestamp[tail] = timestamp;
+        KNX_RX_RING_BARRIER();
+        _tail = next; // publish the byte once its content is written
+        return true;
+    }
+
+    /**
+     * Pop the oldest received byte (consumer side)
+     * @param data the popped byte
+     * @param timestamp reception time of the popped byte (in usec)
+     * @return false, if no byte available
+     */
+    inline boolean pop(byte& data, word& timestamp) {
+        byte head = _head;
+        if (head == _tail) return false;
+        KNX_RX_RING_BARRIER();
+        data = _data[head];
+        timestamp = _timestamp[head];
+        KNX_RX_RING_BARRIER();
+        _head = (head + 1) & KNX_RX_RING_MASK; // release the slot once its content is read
+        return true;
+    }
+
+    /**
+     * Get the oldest received byte without removing it (consumer side)
+     * @param data the oldest byte
+     * @param timestamp reception time of the oldest byte (in usec)
+     * @return false, if no byte available (the parameters are left unchanged)
+     */
+    inline boolean peek(byte& data, word& timestamp) const {
+        byte head = _head;
+        if (head == _tail) return false;
+        KNX_RX_RING_BARRIER();
+        data = _data[head];
+        timestamp = _timestamp[head];
+        return true;
+    }
+
+    /**
+     * Returns number of bytes available in the ring (consumer side)
+     * @return byte count
+     */
+    inline byte available(void) const {
+        return (byte)((_tail - _head) & KNX_RX_RING_MASK);
+    }
+
+    /**
+     * Returns number of bytes lost because the ring was full
+     * @return overflow count (saturated at 255)
+     */
+    inline byte getOverflowCount(void) const {
+        return _overflowCount;
+    }
+};
+
+#endif // KNXRXRING_H
@@ -27,7 +27,17 @@
 
 #include "KnxTelegram.h"
 
-KnxTelegram::KnxTelegram() { clearTelegram(); }; // Clear telegram with default values
+// Pool of the extension buffers of the extended telegrams
+#if KNX_TELEGRAM_EXTENSION_POOL_SIZE
+static byte extensionPool[KNX_TELEGRAM_EXTENSION_POOL_SIZE][KNX_TELEGRAM_EXTENSION_SIZE];
+static byte extensionPoolUsed = 0; // bit i set when the buffer i is used
+#endif
+
+
+KnxTelegram::KnxTelegram() : _extension(NULL) { clearTelegram(); }; // Clear telegram with default values
+
+
+KnxTelegram::~KnxTelegram() { releaseExtension(); }
 
 
 void KnxTelegram::clearTelegram(void)
@@ -38,51 +48,153 @@ void KnxTelegram::clearTelegram(void)
   memset(_telegram,0,KNX_TELEGRAM_MAX_SIZE);
   _controlField = CONTROL_FIELD_DEFAULT_VALUE ; 
   _routing= ROUTING_FIELD_DEFAULT_VALUE;
+  _extPayloadLength = 0;
+  releaseExtension();
+}
+
+
+boolean KnxTelegram::setPayloadLength(byte length)
+{
+  if (length < KNX_TELEGRAM_PAYLOAD_MAX_SIZE)
+  { // standard telegram
+    _controlField &= ~CONTROL_FIELD_FRAME_FORMAT_MASK; _controlField |= CONTROL_FIELD_STANDARD_FRAME_FORMAT;
+    _routing &= ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK ; _routing |= length;
+    releaseExtension();
+    return true;
+  }
+  // extended telegram, the checksum is beyond the standard telegram bytes
+  if ((length > KNX_EXTENDED_PAYLOAD_MAX_SIZE) || !reserveExtension()) return false;
+  _controlField &= ~CONTROL_FIELD_FRAME_FORMAT_MASK; _controlField |= CONTROL_FIELD_EXTENDED_FRAME_FORMAT;
+  _routing &= ~EXTENDED_CONTROL_FIELD_FORMAT_MASK; // Standard L_DATA extended format
+  _extPayloadLength = length;
+  return true;
+}
+
+
+boolean KnxTelegram::reserveExtension(void)
+{
+  if (_extension) return true;
+#if KNX_TELEGRAM_EXTENSION_POOL_SIZE
+  for (byte i = 0; i < KNX_TELEGRAM_EXTENSION_POOL_SIZE; i++)
+  {
+    if (!(extensionPoolUsed & (1 << i)))
+    {
+      extensionPoolUsed |= (1 << i);
+      _extension = extensionPool[i];
+      return true;
+    }
+  }
+#endif
+  return false;
 }
 
-   
+
+void KnxTelegram::releaseExtension(void)
+{
+#if KNX_TELEGRAM_EXTENSION_POOL_SIZE
+  if (_extension) extensionPoolUsed &= ~(1 << ((_extension - extensionPool[0]) / KNX_TELEGRAM_EXTENSION_SIZE));
+#endif
+  _extension = NULL;
+}
+
+
+byte KnxTelegram::getFreeExtensionsNb(void)
+{
+  byte freeNb = 0;
+#if KNX_TELEGRAM_EXTENSION_POOL_SIZE
+  for (byte i = 0; i < KNX_TELEGRAM_EXTENSION_POOL_SIZE; i++) if (!(extensionPoolUsed & (1 << i))) freeNb++;
+#endif
+  return freeNb;
+}
+
+
+// Raw bytes of an extended telegram : byte 1 (extended control field) is stored in place of the routing field,
+// byte 6 (length) aside, and the following bytes are shifted by one to keep the standard layout
+byte KnxTelegram::readExtendedRawByte(word byteIndex) const
+{
+  if (byteIndex == 0) return _controlField;
+  if (byteIndex == 1) return _routing;
+  if (byteIndex < KNX_EXTENDED_TELEGRAM_HEADER_SIZE - 1) return _telegram[byteIndex - 1];
+  if (byteIndex == KNX_EXTENDED_TELEGRAM_HEADER_SIZE - 1) return _extPayloadLength;
+  return readByte(byteIndex - 1);
+}
+
+
+void KnxTelegram::writeExtendedRawByte(byte data, word byteIndex)
+{
+  if (byteIndex == 1) _routing = data;
+  else if (byteIndex < KNX_EXTENDED_TELEGRAM_HEADER_SIZE - 1) _telegram[byteIndex - 1] = data;
+  else if (byteIndex == KNX_EXTENDED_TELEGRAM_HEADER_SIZE - 1) _extPayloadLength = data;
+  else writeByte(data, byteIndex - 1);
+}
+
+
+// NB : the max length of the long payload is 14 bytes for a standard telegram, and up to 253 bytes for an extended one
 void KnxTelegram::setLongPayload(const byte origin[], byte nbOfBytes) 
 {
-  if (nbOfBytes > KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2) nbOfBytes = KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2;
-  for(byte i=0; i < nbOfBytes; i++) _payloadChecksum[i] = origin[i];
+  if ((nbOfBytes > KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2) && !_extension) nbOfBytes = KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2;
+  if (nbOfBytes > KNX_EXTENDED_PAYLOAD_MAX_SIZE-1) nbOfBytes = KNX_EXTENDED_PAYLOAD_MAX_SIZE-1;
+  for(byte i=0; i < nbOfBytes; i++) writeByte(origin[i], KNX_TELEGRAM_LENGTH_OFFSET + i);
 }
 
 
 void KnxTelegram::clearLongPayload(void)
 {
   memset(_payloadChecksum,0,KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1);
+  if (_extension) memset(_extension,0,KNX_TELEGRAM_EXTENSION_SIZE);
 }
 
 
 void KnxTelegram::getLongPayload(byte destination[], byte nbOfBytes) const
 {
-  if (nbOfBytes > KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2) nbOfBytes = KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2 ;
-  memcpy(destination, _payloadChecksum, nbOfBytes);
+  if ((nbOfBytes > KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2) && !_extension) nbOfBytes = KNX_TELEGRAM_PAYLOAD_MAX_SIZE-2;
+  if (nbOfBytes > KNX_EXTENDED_PAYLOAD_MAX_SIZE-1) nbOfBytes = KNX_EXTENDED_PAYLOAD_MAX_SIZE-1;
+  if (nbOfBytes <= KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1) memcpy(destination, _payloadChecksum, nbOfBytes);
+  else
+  {
+    memcpy(destination, _payloadChecksum, KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1);
+    memcpy(destination + KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1, _extension, nbOfBytes - (KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1));
+  }
 };
     
 
 byte KnxTelegram::calculateChecksum(void) const
 {
-  byte indexChecksum, xorSum=0;  
+  word indexChecksum; byte xorSum=0;  
   indexChecksum = KNX_TELEGRAM_HEADER_SIZE + getPayloadLength() + 1;
-  for (byte i = 0; i < indexChecksum ; i++)   xorSum ^= _telegram[i]; // XOR Sum of all the databytes
+  for (word i = 0; i < indexChecksum ; i++)   xorSum ^= readByte(i); // XOR Sum of all the databytes
+  if (isExtended()) xorSum ^= _extPayloadLength; // the length byte is not part of the stored bytes
   return (byte)(~xorSum); // Checksum equals 1's complement of databytes XOR sum
 }
 
 
 void KnxTelegram::updateChecksum(void)
 {
-  byte indexChecksum, xorSum=0; 
-  indexChecksum = KNX_TELEGRAM_HEADER_SIZE + getPayloadLength() + 1;
-  for (byte i = 0; i < indexChecksum ; i++)   xorSum ^= _telegram[i]; // XOR Sum of all the databytes
-  _telegram[indexChecksum] = ~xorSum; // Checksum equals 1's complement of databytes XOR sum
+  writeByte(calculateChecksum(), KNX_TELEGRAM_HEADER_SIZE + getPayloadLength() + 1);
 }
 
 
-void KnxTelegram::copy(KnxTelegram& dest) const
+boolean KnxTelegram::copy(KnxTelegram& dest) const
 {
-  byte length = getTelegramLength();
-  memcpy(dest._telegram, _telegram, length);
+  word length = KNX_TELEGRAM_LENGTH_OFFSET + getPayloadLength(); // stored bytes
+  boolean complete = true;
+  if ((length > KNX_TELEGRAM_MAX_SIZE) && !dest.reserveExtension())
+  {
+    length = KNX_TELEGRAM_MAX_SIZE;
+    complete = false;
+  }
+  if (length <= KNX_TELEGRAM_MAX_SIZE)
+  {
+    if (complete) dest.releaseExtension();
+    memcpy(dest._telegram, _telegram, length);
+  }
+  else
+  {
+    memcpy(dest._telegram, _telegram, KNX_TELEGRAM_MAX_SIZE);
+    memcpy(dest._extension, _extension, length - KNX_TELEGRAM_MAX_SIZE);
+  }
+  dest._extPayloadLength = _extPayloadLength;
+  return complete;
 }
 
 
@@ -95,7 +207,13 @@ void KnxTelegram::copyHeader(KnxTelegram& dest) const
 e_KnxTelegramValidity KnxTelegram::getValidity(void) const
 {
   if ((_controlField & CONTROL_FIELD_PATTERN_MASK) != CONTROL_FIELD_VALID_PATTERN) return KNX_TELEGRAM_INVALID_CONTROL_FIELD; 
-  if ((_controlField & CONTROL_FIELD_FRAME_FORMAT_MASK) != CONTROL_FIELD_STANDARD_FRAME_FORMAT) return KNX_TELEGRAM_UNSUPPORTED_FRAME_FORMAT; 
+  if (isExtended())
+  {
+    if (_routing & EXTENDED_CONTROL_FIELD_FORMAT_MASK) return KNX_TELEGRAM_UNSUPPORTED_FRAME_FORMAT;
+    if ((_extPayloadLength > KNX_EXTENDED_PAYLOAD_MAX_SIZE) 
+        || ((_extPayloadLength >= KNX_TELEGRAM_PAYLOAD_MAX_SIZE) && !_extension)) return KNX_TELEGRAM_INCORRECT_PAYLOAD_LENGTH;
+  }
+  else if ((_controlField & CONTROL_FIELD_FRAME_FORMAT_MASK) != CONTROL_FIELD_STANDARD_FRAME_FORMAT) return KNX_TELEGRAM_UNSUPPORTED_FRAME_FORMAT; 
   if (!getPayloadLength()) return KNX_TELEGRAM_INCORRECT_PAYLOAD_LENGTH ;
   if ((_commandH & COMMAND_FIELD_PATTERN_MASK) != COMMAND_FIELD_VALID_PATTERN) return KNX_TELEGRAM_INVALID_COMMAND_FIELD;
   if ( getChecksum() != calculateChecksum()) return KNX_TELEGRAM_INCORRECT_CHECKSUM ;
@@ -123,14 +241,14 @@ void KnxTelegram::info(String& str) const
     default : str+="ERR_VAL!"; break;
   }
   str+="\nPayload=" + String(getFirstPayloadByte(),HEX)+' ';
-  for (byte i = 0; i < payloadLength-1; i++) str+=String(_payloadChecksum[i], HEX)+' ';
+  for (byte i = 0; i < payloadLength-1; i++) str+=String(readByte(KNX_TELEGRAM_LENGTH_OFFSET + i), HEX)+' ';
   str+='\n';
 }
 
 
 void KnxTelegram::KnxTelegram::infoRaw(String& str) const
 {
-  for (byte i = 0; i < KNX_TELEGRAM_MAX_SIZE; i++) str+=String(_telegram[i], HEX)+' ';
+  for (word i = 0; i < getTelegramLength(); i++) str+=String(readRawByte(i), HEX)+' ';
   str+='\n';
 }
 
@@ -151,6 +269,7 @@ void KnxTelegram::infoVerbose(String& str) const
   str+="\nSrcAddr=" + String(getSourceAddress(),HEX);
   str+="\nTargetAddr=" + String(getTargetAddress(),HEX);
   str+="\nGroupAddr="; if (isMulticast()) str+= "YES"; else str+="NO";
+  str+="\nExtended="; if (isExtended()) str+= "YES"; else str+="NO";
   str+="\nRout.Counter=" + String(getRoutingCounter(),DEC);
   str+="\nPayloadLgth=" + String(payloadLength,DEC);
   str+="\nTelegramLength=" + String(getTelegramLength(),DEC);
@@ -164,7 +283,7 @@ void KnxTelegram::infoVerbose(String& str) const
     default : str+="ERR_VAL!"; break;
   }
   str+="\nPayload=" + String(getFirstPayloadByte(),HEX)+' ';
-  for (byte i = 0; i < payloadLength-1; i++) str+=String(_payloadChecksum[i], HEX)+' ';
+  for (byte i = 0; i < payloadLength-1; i++) str+=String(readByte(KNX_TELEGRAM_LENGTH_OFFSET + i), HEX)+' ';
   str+="\nValidity=";
    switch(getValidity())
   {
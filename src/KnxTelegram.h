@@ -21,7 +21,7 @@
 #include "Arduino.h"
 
 // ---------- Knx Telegram description (visit "www.knx.org" for more info) -----------
-// => Length : 9 bytes min. to 23 bytes max.
+// => Length : 9 bytes min. to 23 bytes max. (standard frame)
 //
 // => Structure :
 //      -Header (6 bytes):
@@ -56,6 +56,21 @@
 //     -from 20ms for 1 byte payload telegram (Bus temporisation + Telegram transmit + ACK)
 //     -up to 40ms for 15 bytes payload (Bus temporisation + Telegram transmit + ACK)
 //
+// ---------- Extended Frame Format (payload length up to 254 bytes) -----------
+// => Structure :
+//        Byte 0 | Control Field (Frame Format = 00)
+//        Byte 1 | Extended Control Field, "TCCC FFFF" format (T and CCC as in the Routing field, FFFF = 0000)
+//        Byte 2 to 5 | Source and Destination Addresses
+//        Byte 6 | Payload Length
+//        Byte 7 | Commmand field High
+//        Byte 8 up to the end | Command field Low and payload bytes, then Checksum
+//
+// => Storage :
+//     The telegram is stored with the standard layout (the Extended Control Field takes place of the Routing field,
+//     the payload length is stored aside), so the fields are got the same way whatever the frame format.
+//     The bytes beyond KNX_TELEGRAM_MAX_SIZE are stored in an extension buffer taken from a fixed-size pool,
+//     so the standard telegrams don't pay for the extended size.
+//
 
 // Define for lengths & offsets
 #define KNX_TELEGRAM_HEADER_SIZE        6
@@ -63,6 +78,28 @@
 #define KNX_TELEGRAM_MIN_SIZE           9
 #define KNX_TELEGRAM_MAX_SIZE          23
 #define KNX_TELEGRAM_LENGTH_OFFSET      8 // Offset between payload length and telegram length
+#define KNX_EXTENDED_TELEGRAM_HEADER_SIZE 7
+
+// Max payload length of the extended telegrams (16 to 254)
+#ifndef KNX_EXTENDED_PAYLOAD_MAX_SIZE
+#define KNX_EXTENDED_PAYLOAD_MAX_SIZE 254
+#endif
+#if (KNX_EXTENDED_PAYLOAD_MAX_SIZE < KNX_TELEGRAM_PAYLOAD_MAX_SIZE) || (KNX_EXTENDED_PAYLOAD_MAX_SIZE > 254)
+#error "KNX_EXTENDED_PAYLOAD_MAX_SIZE shall be between 16 and 254"
+#endif
+#define KNX_EXTENDED_TELEGRAM_MAX_SIZE (KNX_EXTENDED_PAYLOAD_MAX_SIZE + KNX_TELEGRAM_LENGTH_OFFSET + 1)
+
+// Nb of extension buffers in the pool (0 to 8), i.e. max nb of telegrams with a payload longer than 15 bytes at the same time
+// NB : with no pool (default), only the extended telegrams with a payload up to 15 bytes are handled
+// The long payloads are an opt-in, each buffer takes KNX_TELEGRAM_EXTENSION_SIZE bytes of RAM (e.g. -DKNX_TELEGRAM_EXTENSION_POOL_SIZE=2)
+#ifndef KNX_TELEGRAM_EXTENSION_POOL_SIZE
+#define KNX_TELEGRAM_EXTENSION_POOL_SIZE 0
+#endif
+#if (KNX_TELEGRAM_EXTENSION_POOL_SIZE > 8)
+#error "KNX_TELEGRAM_EXTENSION_POOL_SIZE shall be between 0 and 8"
+#endif
+// Size of an extension buffer (the length byte of the extended telegrams is not stored in the telegram bytes)
+#define KNX_TELEGRAM_EXTENSION_SIZE (KNX_EXTENDED_TELEGRAM_MAX_SIZE - 1 - KNX_TELEGRAM_MAX_SIZE)
 
 enum e_KnxPriority {
   KNX_PRIORITY_SYSTEM_VALUE  = B00000000,
@@ -82,6 +119,7 @@ enum e_KnxCommand {
 #define CONTROL_FIELD_DEFAULT_VALUE         B10111100 // Standard FF; No Repeat; Normal Priority
 #define CONTROL_FIELD_FRAME_FORMAT_MASK     B11000000
 #define CONTROL_FIELD_STANDARD_FRAME_FORMAT B10000000
+#define CONTROL_FIELD_EXTENDED_FRAME_FORMAT B00000000
 #define CONTROL_FIELD_REPEATED_MASK         B00100000
 #define CONTROL_FIELD_SET_REPEATED(x)       (x&=B11011111)
 #define CONTROL_FIELD_PRIORITY_MASK         B00001100
@@ -93,6 +131,7 @@ enum e_KnxCommand {
 #define ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK B10000000
 #define ROUTING_FIELD_COUNTER_MASK             B01110000 
 #define ROUTING_FIELD_PAYLOAD_LENGTH_MASK      B00001111
+#define EXTENDED_CONTROL_FIELD_FORMAT_MASK     B00001111 // Extended Frame Format, 0000 for the standard L_DATA service
 
 // --- COMMAND FIELD values & masks ---
 #define COMMAND_FIELD_HIGH_COMMAND_MASK 0x03 
@@ -124,12 +163,27 @@ class KnxTelegram {
         byte _payloadChecksum[KNX_TELEGRAM_PAYLOAD_MAX_SIZE-1]; // byte 8 to 22
       };
     };
+    byte _extPayloadLength; // payload length of an extended telegram
+    byte *_extension;       // bytes from KNX_TELEGRAM_MAX_SIZE, for the extended telegrams (NULL if none)
+
+    // Access to the telegram bytes (standard layout) including the extension ones
+    byte readByte(word index) const;
+    void writeByte(byte data, word index);
+
+    // Raw byte access of the extended telegrams
+    byte readExtendedRawByte(word byteIndex) const;
+    void writeExtendedRawByte(byte data, word byteIndex);
+
+    // A telegram owns its extension buffer, so it can't be copied (use copy() instead)
+    KnxTelegram(const KnxTelegram&);
+    KnxTelegram& operator=(const KnxTelegram&);
 
   public:
   // CONSTRUCTOR
     // builds telegram with following default values :
     // std FF, no repeat, normal prio, empty payload, multicast, routing counter = 6, payload length = 1
     KnxTelegram();
+    ~KnxTelegram();
     
   // INLINED functions (defined later in this file)
     void changePriority(e_KnxPriority priority);
@@ -149,10 +203,11 @@ class KnxTelegram {
     void changeRoutingCounter(byte counter);
     byte getRoutingCounter(void) const;
 
-    void setPayloadLength(byte length);
     byte getPayloadLength(void) const;
 
-    byte getTelegramLength(void) const;
+    word getTelegramLength(void) const;
+
+    boolean isExtended(void) const;
 
     void setCommand(e_KnxCommand cmd);
     e_KnxCommand getCommand(void) const;
@@ -164,11 +219,12 @@ class KnxTelegram {
 
     // Read of the telegram byte per byte
     // NB : do not check that the index is in the range
-    byte readRawByte(byte byteIndex) const;
+    byte readRawByte(word byteIndex) const;
 
     // Write of the telegram byte per byte
     // NB : do not check that the index is in the range
-    void writeRawByte(byte data, byte byteIndex);
+    // The frame format is given by the control field (byte 0), so it shall be written first
+    void writeRawByte(byte data, word byteIndex);
 
     byte getChecksum(void) const;
     boolean isChecksumCorrect(void) const;
@@ -176,6 +232,21 @@ class KnxTelegram {
   // functions NOT INLINED (see definitions in KnxTelegram.cpp)
     void clearTelegram(void); // (re)set telegram with default values
 
+    // Set the payload length
+    // A length up to 15 gives a standard telegram, a longer one an extended telegram
+    // return false if the length is out of range or if no extension buffer is available (the telegram is then unchanged)
+    boolean setPayloadLength(byte length);
+
+    // Take an extension buffer from the pool (if the telegram has none yet)
+    // return false if the pool is empty
+    boolean reserveExtension(void);
+    // Give the extension buffer back to the pool
+    void releaseExtension(void);
+    boolean hasExtension(void) const;
+
+    // Nb of extension buffers available in the pool
+    static byte getFreeExtensionsNb(void);
+
     // Set 'nbOfBytes' bytes of the payload starting from the 2nd payload byte
     // if 'nbOfBytes' val is out of range, then we use the max allowed value instead
     void setLongPayload(const byte origin[], byte  nbOfBytes);
@@ -191,7 +262,8 @@ class KnxTelegram {
     void updateChecksum(void);
 
     // Whole telegram copy
-    void copy(KnxTelegram& dest) const;
+    // return false if the destination could not get the extension buffer needed (the payload is then truncated)
+    boolean copy(KnxTelegram& dest) const;
     // Header Copy (6 1st bytes of the telegram)
     void copyHeader(KnxTelegram& dest) const;
 
@@ -204,6 +276,27 @@ class KnxTelegram {
 };
 
 
+// Streaming validation of a telegram being received
+// Each byte is folded in as it arrives (running XOR, field patterns checks), so that the verdict
+// (same checks as KnxTelegram::getValidity()) is ready as soon as the checksum byte is received
+class KnxTelegramValidator {
+    byte _xorSum;                     // XOR sum of the bytes received so far (0xFF once the correct checksum is added)
+    byte _commandH;                   // Command field high byte, needed to check the command on next byte
+    boolean _extended;                // Extended Frame Format (got from the control field)
+    e_KnxTelegramValidity _validity;  // First failure found in the received fields
+
+  public:
+    // Start the validation of a new telegram
+    void start(void);
+
+    // Fold the byte received at index in the validation
+    void addByte(byte data, word index);
+
+    // Telegram validity, to be got once the checksum byte has been added
+    e_KnxTelegramValidity getValidity(void) const;
+};
+
+
 // --------------- Definition of the INLINED functions : -----------------
 inline void KnxTelegram::changePriority(e_KnxPriority priority)
 { _controlField &= ~CONTROL_FIELD_PRIORITY_MASK; _controlField |= priority & CONTROL_FIELD_PRIORITY_MASK;}
@@ -250,14 +343,27 @@ inline void KnxTelegram::changeRoutingCounter(byte counter)
 inline byte KnxTelegram::getRoutingCounter(void) const 
 { return ((_routing & ROUTING_FIELD_COUNTER_MASK)>>4); }
 
-inline void KnxTelegram::setPayloadLength(byte length) 
-{ _routing&= ~ROUTING_FIELD_PAYLOAD_LENGTH_MASK ; _routing |= length & ROUTING_FIELD_PAYLOAD_LENGTH_MASK; }
+inline boolean KnxTelegram::isExtended(void) const
+{ return ((_controlField & CONTROL_FIELD_FRAME_FORMAT_MASK) == CONTROL_FIELD_EXTENDED_FRAME_FORMAT);}
 
 inline byte KnxTelegram::getPayloadLength(void) const 
-{return (_routing & ROUTING_FIELD_PAYLOAD_LENGTH_MASK);}
+{ if (isExtended()) return _extPayloadLength;
+  return (_routing & ROUTING_FIELD_PAYLOAD_LENGTH_MASK);}
+
+inline word KnxTelegram::getTelegramLength(void) const 
+{ if (isExtended()) return (KNX_TELEGRAM_LENGTH_OFFSET + 1 + _extPayloadLength); // + 1 for the length byte
+  return (KNX_TELEGRAM_LENGTH_OFFSET + getPayloadLength());}
+
+inline boolean KnxTelegram::hasExtension(void) const
+{ return (_extension != NULL);}
 
-inline byte KnxTelegram::getTelegramLength(void) const 
-{ return (KNX_TELEGRAM_LENGTH_OFFSET + getPayloadLength());}
+inline byte KnxTelegram::readByte(word index) const
+{ if (index < KNX_TELEGRAM_MAX_SIZE) return _telegram[index];
+  return (_extension ? _extension[index - KNX_TELEGRAM_MAX_SIZE] : 0);}
+
+inline void KnxTelegram::writeByte(byte data, word index)
+{ if (index < KNX_TELEGRAM_MAX_SIZE) _telegram[index] = data;
+  else if (_extension) _extension[index - KNX_TELEGRAM_MAX_SIZE] = data;}
 
 inline void KnxTelegram::setCommand(e_KnxCommand cmd) {
   _commandH &= ~COMMAND_FIELD_HIGH_COMMAND_MASK; _commandH |= (cmd >> 2);
@@ -275,16 +381,68 @@ inline void KnxTelegram::clearFirstPayloadByte(void)
 inline byte KnxTelegram::getFirstPayloadByte(void) const 
 { return (_commandL & COMMAND_FIELD_LOW_DATA_MASK);}
 
-inline byte KnxTelegram::readRawByte(byte byteIndex) const
-{ return _telegram[byteIndex];}
+inline byte KnxTelegram::readRawByte(word byteIndex) const
+{ if (isExtended()) return readExtendedRawByte(byteIndex);
+  return _telegram[byteIndex];}
 
-inline void KnxTelegram::writeRawByte(byte data, byte byteIndex)
-{ _telegram[byteIndex] = data;}
+inline void KnxTelegram::writeRawByte(byte data, word byteIndex)
+{ if (byteIndex && isExtended()) writeExtendedRawByte(data, byteIndex);
+  else _telegram[byteIndex] = data;}
 
 inline byte KnxTelegram::getChecksum(void) const 
-{ return (_payloadChecksum[getPayloadLength() - 1]);}
+{ return readByte(KNX_TELEGRAM_LENGTH_OFFSET - 1 + getPayloadLength());}
 
 inline boolean KnxTelegram::isChecksumCorrect(void) const 
 { return (getChecksum()==calculateChecksum());}
 
+inline void KnxTelegramValidator::start(void)
+{ _xorSum = 0; _extended = false; _validity = KNX_TELEGRAM_VALID;}
+
+inline void KnxTelegramValidator::addByte(byte data, word index)
+{
+  _xorSum ^= data;
+  if (_validity != KNX_TELEGRAM_VALID) return; // the first failure is kept
+  if (_extended && index) {
+    // extended telegram : check the extended control and length fields, the command field is one byte further
+    if (index == 1) {
+      if (data & EXTENDED_CONTROL_FIELD_FORMAT_MASK) _validity = KNX_TELEGRAM_UNSUPPORTED_FRAME_FORMAT;
+      return;
+    }
+    if (index == KNX_EXTENDED_TELEGRAM_HEADER_SIZE - 1) {
+      if (!data || (data > KNX_EXTENDED_PAYLOAD_MAX_SIZE)) _validity = KNX_TELEGRAM_INCORRECT_PAYLOAD_LENGTH;
+      return;
+    }
+    if (index < KNX_EXTENDED_TELEGRAM_HEADER_SIZE) return;
+    index--;
+  }
+  switch (index) {
+    case 0 : // control field
+      _extended = ((data & CONTROL_FIELD_FRAME_FORMAT_MASK) == CONTROL_FIELD_EXTENDED_FRAME_FORMAT);
+      if ((data & CONTROL_FIELD_PATTERN_MASK) != CONTROL_FIELD_VALID_PATTERN) _validity = KNX_TELEGRAM_INVALID_CONTROL_FIELD;
+      else if (((data & CONTROL_FIELD_FRAME_FORMAT_MASK) != CONTROL_FIELD_STANDARD_FRAME_FORMAT) && !_extended) _validity = KNX_TELEGRAM_UNSUPPORTED_FRAME_FORMAT;
+      break;
+    case 5 : // routing field
+      if (!(data & ROUTING_FIELD_PAYLOAD_LENGTH_MASK)) _validity = KNX_TELEGRAM_INCORRECT_PAYLOAD_LENGTH;
+      break;
+    case 6 : // command field high byte
+      _commandH = data;
+      if ((data & COMMAND_FIELD_PATTERN_MASK) != COMMAND_FIELD_VALID_PATTERN) _validity = KNX_TELEGRAM_INVALID_COMMAND_FIELD;
+      break;
+    case 7 : { // command field low byte
+      byte cmd = ((data & COMMAND_FIELD_LOW_COMMAND_MASK) >> 6) + ((_commandH & COMMAND_FIELD_HIGH_COMMAND_MASK) << 2);
+      if (    (cmd != KNX_COMMAND_VALUE_READ) && (cmd != KNX_COMMAND_VALUE_RESPONSE)
+           && (cmd != KNX_COMMAND_VALUE_WRITE) && (cmd != KNX_COMMAND_MEMORY_WRITE)) _validity = KNX_TELEGRAM_UNKNOWN_COMMAND;
+    } break;
+    default : break;
+  }
+}
+
+inline e_KnxTelegramValidity KnxTelegramValidator::getValidity(void) const
+{
+  // same priority as KnxTelegram::getValidity() : the checksum is checked before the command
+  if ((_validity != KNX_TELEGRAM_VALID) && (_validity != KNX_TELEGRAM_UNKNOWN_COMMAND)) return _validity;
+  if (_xorSum != 0xFF) return KNX_TELEGRAM_INCORRECT_CHECKSUM;
+  return _validity;
+}
+
 #endif // KNXTELEGRAM_H
\ No newline at end of file
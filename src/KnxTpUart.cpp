@@ -54,20 +54,31 @@ static inline word TimeDeltaWord(word now, word before) {
 KnxTpUart::KnxTpUart(HardwareSerial& serial, word physicalAddr, KnxTpUartMode mode)
     : _serial(serial), _physicalAddr(physicalAddr), _mode(mode) {
     _rx.state = RX_RESET;
+    _rx.head = 0;
+    _rx.tail = 0;
+    _rx.count = 0;
+    _rx.takenNb = 0;
+    _rx.releasedMask = 0;
+    _rx.telegramCompletelyReceived = false;
+    _rx.expectedTelegramLength = 0;
+    _rx.readBytesNb = 0;
+    _rx.lastByteRxTime = 0;
+    _rx.busBytesNb = 0;
+    _rx.monitorData.isEOP = true;
+    _rx.monitorData.dataByte = 0;
+    _rx.monitorData.timestamp = 0;
+    _tx.sentMessageTime = 0;
+    _tx.bufferSize = 0;
     _tx.state = TX_RESET;
     _tx.sentTelegram = NULL;
     _tx.ackFctPtr = NULL;
     _tx.nbRemainingBytes = 0;
     _tx.txByteIndex = 0;
     _stateIndication = 0;
+    _rxRing = NULL;
     _evtCallbackFct = NULL;
     _comObjectsList = NULL;
     _assignedComObjectsNb = 0;
-    _stateIndication = 0;
-
-    _addressedComObjects.size = max(1, Konnekting._assocMaxTableEntries); // make list at least size=1 to be able to add ProgGA
-    DEBUG_PRINTLN(F("Malloc for maxaddressedComObj: %d"), _addressedComObjects.size); 
-    _addressedComObjects.list = (byte*)malloc(_addressedComObjects.size * sizeof(byte));
 }
 
 // Destructor
@@ -110,9 +121,9 @@ byte KnxTpUart::reset(void) {
         _serial.write(TPUART_RESET_REQ);  // send RESET REQUEST
 
         for (nowTime = startTime = (word)millis(); TimeDeltaWord(nowTime, startTime) < 1000 /* 1 sec */; nowTime = (word)millis()) {
-            if (_serial.available() > 0) {
-                DEBUG_PRINTLN("Data available: %d", _serial.available());
-                byte data = _serial.read();
+            if (rxAvailable()) {
+                word timestamp;
+                byte data = rxRead(timestamp);
                 if (data == TPUART_RESET_INDICATION) {
                     _rx.state = RX_INIT;
                     _tx.state = TX_INIT;
@@ -222,88 +233,70 @@ byte KnxTpUart::sendTelegram(KnxTelegram& sentTelegram) {
  * In order not to miss any End Of Packets (i.e. a gap from 2 to 2,5ms), the function shall be called at a 
  * max period of 0,5ms.
  * Typical calling period is 400 usec.
+ * This constraint does not apply when an RX ring is attached (see attachRxRing()): each byte is then 
+ * timestamped by the UART RX interrupt and the EOP is detected from the real gaps between bytes.
  * 
  * DO NOT PUT TOO MUCH DEBUG PRINT CODE HERE! Telegram receiving might break!
  */
 void KnxTpUart::rxTask(void) {
     byte incomingByte;
-    word nowTime;
-    static bool telegramCompletelyReceived = false;
-    static byte expectedTelegramLength = 0;
-    static byte readBytesNb;      // Nb of read bytes during an KNX telegram reception
-    static KnxTelegram telegram;  // telegram being received
-    static word lastByteRxTimeMicrosec;
+    word nowTime, startTime;
+    byte rxBytesBudget;
 
     // === STEP 1 : Check EOP in case a Telegram is being received ===
+    // As every frame is closed as soon as its checksum byte arrives (see STEP 3),
+    // the timeout only applies to truncated frames
+    // The check is only done when no byte is pending : a late poll must not cut a frame whose tail waits in the UART
+    // (or in the RX ring, where the pending bytes carry their own reception time and are checked in STEP 2)
+    // The timeout is counted from the reception time of the last byte (read time without RX ring, which is never
+    // earlier than the real one), the time is got first so that a byte received meanwhile cannot be missed
     if (_rx.state >= RX_KNX_TELEGRAM_RECEPTION_STARTED) {  // a telegram reception is ongoing
 
         // word cast because a 65ms looping counter is long enough
         nowTime = (word)micros();
 
-        if (TimeDeltaWord(nowTime, lastByteRxTimeMicrosec) > KNX_RECEPTION_TIMEOUT || telegramCompletelyReceived) {  // EOP detected, the telegram reception is completed
+        if (!rxAvailable() && (TimeDeltaWord(nowTime, _rx.lastByteRxTime) > KNX_RECEPTION_TIMEOUT)) {  // EOP detected, the telegram is incomplete
             //DEBUG_PRINTLN(F("EOP REACHED"));
-            telegramCompletelyReceived = false;
-
-            switch (_rx.state) {
-                case RX_KNX_TELEGRAM_RECEPTION_STARTED:  // we are not supposed to get EOP now, the telegram is incomplete
-                    DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED"));
-                case RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID:
-                    //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID---"));
-                    _evtCallbackFct(TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR);  // Notify telegram reception error
-                    //DEBUG_PRINTLN(F("TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR"));
-                    break;
-
-                case RX_KNX_TELEGRAM_RECEPTION_ADDRESSED:
-                    //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED"));
-                    if (telegram.isChecksumCorrect()) {
-                        // checksum correct, let's update the _rx struct with the received telegram and correct index
-                        //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED 1"));
-                        telegram.copy(_rx.receivedTelegram);
-                        //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED 2"));
-                        // Notify the new received telegram
-                        _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
-                        _evtCallbackFct(TPUART_EVENT_RECEIVED_KNX_TELEGRAM);
-                    } else {
-                        // checksum incorrect, notify error
-                        DEBUG_PRINTLN(F("checksum incorrect."));
-                        _evtCallbackFct(TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR);  // Notify telegram reception error
-                    }
-                    break;
-
-                case RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED:
-                    break;  // nothing to do!
-
-                default:
-                    break;
-            }  // end of switch
-
-            // we move state back to RX IDLE in any case
-            _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
-
-        }  // end EOP detected
+            _rx.telegramCompletelyReceived = false;
+            rxEndOfTelegram(false);
+        }
     }
 
     // === STEP 2 : Get New RX Data ===
-    if (_serial.available() > 0) {
-        incomingByte = (byte)(_serial.read());
-        lastByteRxTimeMicrosec = (word)micros();
-        //DEBUG_PRINTLN(F("RX:  incomingByte=0x%02x, readBytesNb=%d"), incomingByte, readBytesNb);
+    // All the pending bytes are consumed in a row (batched reception), within the limits of the RX budget
+    rxBytesBudget = KNX_RX_BUDGET_BYTES;
+    startTime = (word)micros();
+    while (rxBytesBudget && rxAvailable()) {
+        KnxTelegram& telegram = _rx.queue[_rx.tail];  // the telegram is received directly in the free slot of the RX queue
+        rxBytesBudget--;
+        incomingByte = rxRead(nowTime);
+
+        // With an RX ring attached, the EOP of a truncated telegram is detected from the real gap before this byte
+        if (_rxRing && (_rx.state >= RX_KNX_TELEGRAM_RECEPTION_STARTED) && (TimeDeltaWord(nowTime, _rx.lastByteRxTime) > KNX_RECEPTION_TIMEOUT)) {
+            _rx.telegramCompletelyReceived = false;
+            rxEndOfTelegram(false);
+        }
+        _rx.lastByteRxTime = nowTime;
+        //DEBUG_PRINTLN(F("RX:  incomingByte=0x%02x, _rx.readBytesNb=%d"), incomingByte, _rx.readBytesNb);
 
         switch (_rx.state) {
             case RX_IDLE_WAITING_FOR_CTRL_FIELD:
-                //DEBUG_PRINTLN(F("RX_IDLE_WAITING_FOR_CTRL_FIELD \nincomingByte=0x%02x, readBytesNb=%d"), incomingByte, readBytesNb);
+                //DEBUG_PRINTLN(F("RX_IDLE_WAITING_FOR_CTRL_FIELD \nincomingByte=0x%02x, _rx.readBytesNb=%d"), incomingByte, _rx.readBytesNb);
 
                 // CASE OF KNX MESSAGE
                 if ((incomingByte & KNX_CONTROL_FIELD_PATTERN_MASK) == KNX_CONTROL_FIELD_VALID_PATTERN) {
                     _rx.state = RX_KNX_TELEGRAM_RECEPTION_STARTED;
-                    readBytesNb = 1;
+                    _rx.readBytesNb = 1;
+                    _rx.expectedTelegramLength = 0;  // unknown until the routing field is received
                     telegram.writeRawByte(incomingByte, 0);
+                    _rx.validator.start();
+                    _rx.validator.addByte(incomingByte, 0);
                     //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED"));
                 }
                 // CASE OF TPUART_DATA_CONFIRM_SUCCESS NOTIFICATION
                 else if (incomingByte == TPUART_DATA_CONFIRM_SUCCESS) {
                     if (_tx.state == TX_WAITING_ACK) {
-                        _tx.ackFctPtr(ACK_RESPONSE);
+                        _tx.ackFctPtr(*this, ACK_RESPONSE);
                         _tx.state = TX_IDLE;
                     } else {
                         //DEBUG_PRINTLN(F("Rx: unexpected TPUART_DATA_CONFIRM_SUCCESS received!"));
@@ -312,18 +305,18 @@ void KnxTpUart::rxTask(void) {
                 // CASE OF TPUART_RESET NOTIFICATION
                 else if (incomingByte == TPUART_RESET_INDICATION) {
                     if ((_tx.state == TX_TELEGRAM_SENDING_ONGOING) || (_tx.state == TX_WAITING_ACK)) {  // response to the TP UART transmission
-                        _tx.ackFctPtr(TPUART_RESET_RESPONSE);
+                        _tx.ackFctPtr(*this, TPUART_RESET_RESPONSE);
                     }
                     _tx.state = TX_STOPPED;
                     _rx.state = RX_STOPPED;
                     // Notify RESET
-                    _evtCallbackFct(TPUART_EVENT_RESET);
+                    _evtCallbackFct(*this, TPUART_EVENT_RESET);
                     //DEBUG_PRINTLN(F("Rx: Reset Indication Received"));
                     return;
                 }
                 // CASE OF STATE_INDICATION RESPONSE
                 else if ((incomingByte & TPUART_STATE_INDICATION_MASK) == TPUART_STATE_INDICATION) {
-                    _evtCallbackFct(TPUART_EVENT_STATE_INDICATION);  // Notify STATE INDICATION
+                    _evtCallbackFct(*this, TPUART_EVENT_STATE_INDICATION);  // Notify STATE INDICATION
                     _stateIndication = incomingByte;
                     //DEBUG_PRINTLN(F("Rx: State Indication Received"));
                 }
@@ -331,7 +324,7 @@ void KnxTpUart::rxTask(void) {
                 else if (incomingByte == TPUART_DATA_CONFIRM_FAILED) {
                     // NACK following Telegram transmission
                     if (_tx.state == TX_WAITING_ACK) {
-                        _tx.ackFctPtr(NACK_RESPONSE);
+                        _tx.ackFctPtr(*this, NACK_RESPONSE);
                         _tx.state = TX_IDLE;
                     } else
                         DEBUG_PRINTLN(F("Rx: unexpected TPUART_DATA_CONFIRM_FAILED received!"));
@@ -344,12 +337,13 @@ void KnxTpUart::rxTask(void) {
                 break;
 
             case RX_KNX_TELEGRAM_RECEPTION_STARTED:
-                //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED incomingByte=0x%02x, readBytesNb=%d"), incomingByte, readBytesNb);
-                telegram.writeRawByte(incomingByte, readBytesNb);
-                readBytesNb++;
+                //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED incomingByte=0x%02x, _rx.readBytesNb=%d"), incomingByte, _rx.readBytesNb);
+                telegram.writeRawByte(incomingByte, _rx.readBytesNb);
+                _rx.validator.addByte(incomingByte, _rx.readBytesNb);
+                _rx.readBytesNb++;
 
                 //we should try to comment out this check, because we can send telegrams that should be received by own self
-                if (readBytesNb == 3) {  // We have just received the source address
+                if (_rx.readBytesNb == (telegram.isExtended() ? 4 : 3)) {  // We have just received the source address
 
                     // we check whether the received KNX telegram is coming from us (i.e. telegram is sent by the TPUART itself)
                     if (telegram.getSourceAddress() == _physicalAddr) {
@@ -357,15 +351,30 @@ void KnxTpUart::rxTask(void) {
                         //DEBUG_PRINTLN(F("message from us, skip."));
                         _rx.state = RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED;
                     }
-                } else if (readBytesNb == 6)
+                } else if (_rx.readBytesNb == 6)
                 // We have just read the routing field containing the address type and the payload length
+                // (for an extended telegram, the target address, the payload length comes with the next byte)
                 {
-                    // Telegram length is payload length + 7 bytes "overhead"
-                    expectedTelegramLength = (incomingByte & KNX_PAYLOAD_LENGTH_MASK) + 7;
+                    // Index of the checksum byte is payload length + 7 bytes "overhead"
+                    if (!telegram.isExtended()) _rx.expectedTelegramLength = (incomingByte & KNX_PAYLOAD_LENGTH_MASK) + 7;
 
                     // We check if the message is addressed to us in order to send the appropriate acknowledge
                     if (isAddressAssigned(telegram.getTargetAddress() /*, addressedComObjIndex*/)) {  // Message addressed to us
 
+                        if (isRxQueueFull()) {
+                            // RX queue full (the application is too slow), the telegram can't be stored :
+                            // we answer BUSY so that the sender repeats it later
+                            _rx.state = RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+                            _serial.write(TPUART_RX_ACK_SERVICE_BUSY);
+                            break;
+                        }
+                        if (telegram.isExtended() && !telegram.reserveExtension() && KNX_TELEGRAM_EXTENSION_POOL_SIZE) {
+                            // no extension buffer available for a possibly long payload, same as queue full
+                            _rx.state = RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+                            _serial.write(TPUART_RX_ACK_SERVICE_BUSY);
+                            break;
+                        }
+
                         // DEBUG_PRINTLN(F("assigned to us: ga=0x%04x index=%d"), telegram.GetTargetAddress(), addressedComObjectIndex);
 
                         _rx.state = RX_KNX_TELEGRAM_RECEPTION_ADDRESSED;
@@ -392,34 +401,112 @@ void KnxTpUart::rxTask(void) {
 
                 //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED"));
 
-                if (readBytesNb == KNX_TELEGRAM_MAX_SIZE) {
-                    _rx.state = RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID;
-                    DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID"));
-                } else {
-                    telegram.writeRawByte(incomingByte, readBytesNb);
-                    //DEBUG_PRINTLN(F("expectedTelegramLength: %d, readBytesNb: %d"),expectedTelegramLength,readBytesNb);
-                    if (expectedTelegramLength == readBytesNb) {
-                        telegramCompletelyReceived = true;
-                        //we are done with reception
-                        //                        DEBUG_PRINTLN(F("we are done, telegramCompletelyReceived: %d"),telegramCompletelyReceived);
-                    } else {
-                        readBytesNb++;
+                if (!_rx.expectedTelegramLength) {
+                    // length byte of an extended telegram, the checksum is at payload length + 8
+                    _rx.expectedTelegramLength = incomingByte + 8;
+                    if (incomingByte < KNX_TELEGRAM_PAYLOAD_MAX_SIZE) {
+                        telegram.releaseExtension();  // the telegram fits in the standard bytes
+                    } else if (!telegram.hasExtension() || (incomingByte > KNX_EXTENDED_PAYLOAD_MAX_SIZE)) {
+                        _rx.state = RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID;
+                        DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID"));
+                        _rx.readBytesNb++;
+                        break;
                     }
                 }
+                telegram.writeRawByte(incomingByte, _rx.readBytesNb);
+                _rx.validator.addByte(incomingByte, _rx.readBytesNb);
+                //DEBUG_PRINTLN(F("_rx.expectedTelegramLength: %d, _rx.readBytesNb: %d"),_rx.expectedTelegramLength,_rx.readBytesNb);
+                if (_rx.expectedTelegramLength == _rx.readBytesNb) {
+                    _rx.telegramCompletelyReceived = true;
+                    //we are done with reception
+                    //                        DEBUG_PRINTLN(F("we are done, _rx.telegramCompletelyReceived: %d"),_rx.telegramCompletelyReceived);
+                } else {
+                    _rx.readBytesNb++;
+                }
                 break;
 
-            // if the message is too long, nothing to do except waiting for EOP
+            // if the message is too long or not addressed, the content is not stored,
+            // but the frame boundary is tracked so that the frame ends with its checksum byte
             case RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID:
-                break;
-
-            // if the message is not addressed, nothing to do except waiting for EOP
             case RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED:
+                if (!_rx.expectedTelegramLength && !telegram.isExtended() && (_rx.readBytesNb == KNX_TELEGRAM_HEADER_SIZE - 1)) {
+                    // routing field of a frame that has been flagged before the header was complete (i.e. our own frame)
+                    _rx.expectedTelegramLength = (incomingByte & KNX_PAYLOAD_LENGTH_MASK) + 7;
+                } else if (!_rx.expectedTelegramLength && telegram.isExtended() && (_rx.readBytesNb == KNX_EXTENDED_TELEGRAM_HEADER_SIZE - 1)) {
+                    // length byte of an extended telegram
+                    _rx.expectedTelegramLength = incomingByte + 8;
+                } else if (_rx.expectedTelegramLength && (_rx.readBytesNb == _rx.expectedTelegramLength)) {
+                    _rx.telegramCompletelyReceived = true;
+                }
+                _rx.readBytesNb++;
                 break;
 
             default:
                 break;
         }  // end of: switch (_rx.state)
-    }      // end of: if (_serial.available() > 0)
+
+        // count the bytes of the telegrams seen on the bus (the checksum byte included) for the bus load estimation
+        if (_rx.state >= RX_KNX_TELEGRAM_RECEPTION_STARTED) _rx.busBytesNb++;
+
+        // === STEP 3 : Close the telegram as soon as its last byte has been received ===
+        // (the next pending byte is then processed as a new control field)
+        if (_rx.telegramCompletelyReceived) {
+            _rx.telegramCompletelyReceived = false;
+            rxEndOfTelegram(true);
+        }
+
+        // stop here if the RX time budget is exhausted, the remaining bytes are processed on next call
+        if (TimeDeltaWord((word)micros(), startTime) > KNX_RX_BUDGET_TIME) break;
+    }  // end of: while (rxAvailable())
+}
+
+/**
+ * End of telegram handling
+ * Called either when the checksum byte of the telegram being received has arrived
+ * or when the reception timeout elapsed (truncated telegram)
+ * 
+ * The telegram is the one being received in the free slot of the RX queue (tail)
+ * 
+ * @param complete true if the telegram has been received up to its checksum byte
+ */
+void KnxTpUart::rxEndOfTelegram(boolean complete) {
+    switch (_rx.state) {
+        case RX_KNX_TELEGRAM_RECEPTION_STARTED:  // we are not supposed to get EOP now, the telegram is incomplete
+            DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_STARTED"));
+        case RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID:
+            //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_LENGTH_INVALID---"));
+            _rx.queue[_rx.tail].releaseExtension();
+            _evtCallbackFct(*this, TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR);  // Notify telegram reception error
+            //DEBUG_PRINTLN(F("TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR"));
+            break;
+
+        case RX_KNX_TELEGRAM_RECEPTION_ADDRESSED:
+            //DEBUG_PRINTLN(F("RX_KNX_TELEGRAM_RECEPTION_ADDRESSED"));
+            if (complete && (_rx.validator.getValidity() == KNX_TELEGRAM_VALID)) {
+                // telegram valid (checksum and fields checked as the bytes arrived), the telegram is kept in the RX queue and the next free slot is used for the next reception
+                // NB : the addressed com objects are evaluated at byte 6 when the queue is not full, so there's a free slot
+                _rx.tail = (_rx.tail + 1) % KNX_RX_QUEUE_SIZE;
+                _rx.count++;
+                // Notify the new received telegram
+                _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
+                _evtCallbackFct(*this, TPUART_EVENT_RECEIVED_KNX_TELEGRAM);
+            } else {
+                // truncated telegram or invalid telegram (e.g. checksum incorrect), notify error
+                DEBUG_PRINTLN(F("telegram invalid."));
+                _rx.queue[_rx.tail].releaseExtension();
+                _evtCallbackFct(*this, TPUART_EVENT_KNX_TELEGRAM_RECEPTION_ERROR);  // Notify telegram reception error
+            }
+            break;
+
+        case RX_KNX_TELEGRAM_RECEPTION_NOT_ADDRESSED:
+            break;  // nothing to do!
+
+        default:
+            break;
+    }  // end of switch
+
+    // we move state back to RX IDLE in any case
+    _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
 }
 
 /**
@@ -434,20 +521,27 @@ void KnxTpUart::rxTask(void) {
 void KnxTpUart::txTask(void) {
     word nowTime;
     byte txByte[2];
-    static word sentMessageTimeMillisec;
+    byte piecesNb;
 
     // STEP 1 : Manage Message Acknowledge timeout
     switch (_tx.state) {
+#if KNX_TX_BURST_BYTES
+        case TX_IDLE:
+            // nothing is being sent, let's get the UART TX buffer size for the burst mode
+            if (_serial.availableForWrite() > _tx.bufferSize) _tx.bufferSize = _serial.availableForWrite();
+            break;
+#endif
+
         case TX_WAITING_ACK:
             // A transmission ACK is awaited, increment Acknowledge timeout
             nowTime = (word)millis();                                                  // word is enough to count up to 500
-            if (TimeDeltaWord(nowTime, sentMessageTimeMillisec) > 500 /* 500 ms */) {  // The no-answer timeout value is defined as follows :
+            if (TimeDeltaWord(nowTime, _tx.sentMessageTime) > 500 /* 500 ms */) {  // The no-answer timeout value is defined as follows :
                 // - The emission duration for a single max sized telegram is 40ms
                 // - The telegram emission might be repeated 3 times (120ms)
                 // - The telegram emission might be delayed by another message transmission ongoing
                 // - The telegram emission might be delayed by the simultaneous transmission of higher prio messages
                 // Let's take around 3 times the max emission duration (160ms) as arbitrary value
-                _tx.ackFctPtr(NO_ANSWER_TIMEOUT);  // Send a No Answer TIMEOUT
+                _tx.ackFctPtr(*this, NO_ANSWER_TIMEOUT);  // Send a No Answer TIMEOUT
                 _tx.state = TX_IDLE;
             }
             break;
@@ -456,25 +550,32 @@ void KnxTpUart::txTask(void) {
             // STEP 2 : send message if any to send
             // In case a telegram reception has just started, and the ACK has not been sent yet,
             // we block the transmission (for around 3,3ms) till the ACK is sent
-            // In that way, the TX buffer will remain empty and the ACK will be sent immediately
-            if (_rx.state != RX_KNX_TELEGRAM_RECEPTION_STARTED) {
+            // In that way, the TX buffer will remain (almost) empty and the ACK will be sent immediately
+            // In burst mode, the telegram pieces are sent in a row as long as the UART TX buffer holds
+            // no more than KNX_TX_BURST_BYTES bytes
+            for (piecesNb = 0; (_rx.state != RX_KNX_TELEGRAM_RECEPTION_STARTED) && txBurstAllowed(piecesNb); piecesNb++) {
+                if (_tx.txByteIndex && !(_tx.txByteIndex & 0x3F)) {
+                    // extended telegram : the index of the bytes beyond 63 is given by an offset service first
+                    _serial.write((byte)(TPUART_DATA_OFFSET_REQ + (_tx.txByteIndex >> 6)));
+                }
                 if (_tx.nbRemainingBytes == 1) {  // We are sending the last byte, i.e checksum
-                    txByte[0] = TPUART_DATA_END_REQ + _tx.txByteIndex;
+                    txByte[0] = TPUART_DATA_END_REQ + (_tx.txByteIndex & 0x3F);
                     txByte[1] = _tx.sentTelegram->readRawByte(_tx.txByteIndex);
                     //DEBUG_PRINTLN(F("data1[%d]=0x%02x"),_tx.txByteIndex, txByte[1]);
                     _serial.write(txByte, 2);  // write the UART control field and the data byte
 
                     // Message sending completed
-                    sentMessageTimeMillisec = (word)millis();  // memorize sending time in order to manage ACK timeout
+                    _tx.sentMessageTime = (word)millis();  // memorize sending time in order to manage ACK timeout
                     _tx.state = TX_WAITING_ACK;
                 } else {
-                    txByte[0] = TPUART_DATA_START_CONTINUE_REQ + _tx.txByteIndex;
+                    txByte[0] = TPUART_DATA_START_CONTINUE_REQ + (_tx.txByteIndex & 0x3F);
                     txByte[1] = _tx.sentTelegram->readRawByte(_tx.txByteIndex);
                     //DEBUG_PRINTLN(F("data2[%d]=0x%02x"),_tx.txByteIndex, txByte[1]);
                     _serial.write(txByte, 2);  // write the UART control field and the data byte
                     _tx.txByteIndex++;
                     _tx.nbRemainingBytes--;
                 }
+                if (_tx.state != TX_TELEGRAM_SENDING_ONGOING) break;
             }
             break;
 
@@ -483,6 +584,25 @@ void KnxTpUart::txTask(void) {
     }  // switch
 }
 
+/**
+ * Check if a telegram piece (up to 3 bytes) can be sent in the txTask() call
+ * Without burst mode, or when the UART TX buffer size is unknown, one piece is sent per call
+ * The UART TX buffer size is taken as the max free space ever seen (mainly got when TX is idle)
+ * 
+ * @param sentPiecesNb nb of pieces already sent in the call
+ * @return true if the piece can be sent
+ */
+boolean KnxTpUart::txBurstAllowed(byte sentPiecesNb) {
+#if KNX_TX_BURST_BYTES
+    int freeSpace = _serial.availableForWrite();
+    if (freeSpace > _tx.bufferSize) _tx.bufferSize = freeSpace;
+    if (_tx.bufferSize <= 0) return (sentPiecesNb == 0);
+    return (_tx.bufferSize - freeSpace + 3 <= KNX_TX_BURST_BYTES);
+#else
+    return (sentPiecesNb == 0);
+#endif
+}
+
 /** Get bus monitoring data (BUS MONITORING mode)
  * The function returns true if a new data has been retrieved (data pointer in argument), else false
  * It shall be called periodically (max period of 0,5ms) in order to allow correct data reception
@@ -490,79 +610,146 @@ void KnxTpUart::txTask(void) {
  */
 boolean KnxTpUart::getMonitoringData(MonitorData& data) {
     word nowTime;
-    static MonitorData currentData = {true, 0};
-    static word lastByteRxTimeMicrosec;
 
     // STEP 1 : Check EOP
-    if (!(currentData.isEOP))  // check that we have not already detected an EOP
+    if (!(_rx.monitorData.isEOP))  // check that we have not already detected an EOP
     {
         // word cast because a 65ms counter is enough
         nowTime = (word)micros();
-        if (TimeDeltaWord(nowTime, lastByteRxTimeMicrosec) > 2000 /* 2 ms */) {  // EOP detected
-            currentData.isEOP = true;
-            currentData.dataByte = 0;
-            data = currentData;
+        if (_rxRing) {  // if a byte is pending in the RX ring, the gap before its reception is checked instead
+            byte nextByte;
+            _rxRing->peek(nextByte, nowTime);
+        }
+        if (TimeDeltaWord(nowTime, _rx.lastByteRxTime) > 2000 /* 2 ms */) {  // EOP detected
+            _rx.monitorData.isEOP = true;
+            _rx.monitorData.dataByte = 0;
+            data = _rx.monitorData;
             return true;
         }
     }
     // STEP 2 : Get New RX Data
-    if (_serial.available() > 0) {
-        currentData.dataByte = (byte)(_serial.read());
-        currentData.isEOP = false;
-        data = currentData;
-        lastByteRxTimeMicrosec = (word)micros();
+    if (rxAvailable()) {
+        _rx.monitorData.dataByte = rxRead(_rx.lastByteRxTime);
+        _rx.monitorData.timestamp = _rx.lastByteRxTime;
+        _rx.monitorData.isEOP = false;
+        data = _rx.monitorData;
         return true;
     }
     return false;  // No data received
 }
 
+/**
+ * Take the oldest received telegram not taken yet from the RX queue
+ * The telegram remains in its queue slot (no copy) until it is released with releaseReceivedTelegram(),
+ * the RX part doesn't write in the slot meanwhile.
+ * Several telegrams can be taken at the same time (i.e. when task() is called again while processing a telegram)
+ * 
+ * @return pointer to the telegram, NULL if there's no telegram to take
+ */
+KnxTelegram* KnxTpUart::takeReceivedTelegram(void) {
+    if (_rx.takenNb == _rx.count) return NULL;
+    KnxTelegram* telegram = &_rx.queue[(_rx.head + _rx.takenNb) % KNX_RX_QUEUE_SIZE];
+    _rx.takenNb++;
+    return telegram;
+}
+
+/**
+ * Release a telegram taken with takeReceivedTelegram(), its slot can be used again by the RX part
+ * The telegrams may be released in any order, the slots are freed in the order of reception
+ * 
+ * @param telegram the telegram to release
+ */
+void KnxTpUart::releaseReceivedTelegram(KnxTelegram* telegram) {
+    telegram->releaseExtension();  // give the extension buffer (if any) back to the pool
+    _rx.releasedMask |= (1 << (telegram - _rx.queue));
+    // free all the released slots from the head of the queue
+    while (_rx.takenNb && (_rx.releasedMask & (1 << _rx.head))) {
+        _rx.releasedMask &= ~(1 << _rx.head);
+        _rx.head = (_rx.head + 1) % KNX_RX_QUEUE_SIZE;
+        _rx.takenNb--;
+        _rx.count--;
+    }
+}
+
+/**
+ * Read a received byte and its reception time
+ * The byte is taken from the RX ring if attached (the time is then the interrupt time), 
+ * else from the serial port (the time is then the current time)
+ * 
+ * @param timestamp filled with the reception time of the byte (in usec)
+ * @return the received byte
+ */
+byte KnxTpUart::rxRead(word& timestamp) {
+    byte data;
+    if (_rxRing) {
+        _rxRing->pop(data, timestamp);
+    } else {
+        data = (byte)(_serial.read());
+        timestamp = (word)micros();
+    }
+    return data;
+}
+
 /**
  * Check if the target address is an assigned com object one
- * if yes, then update index parameter with the index (in the list) 
- * of the targeted com object and return true else return false
+ * Called on reception of the routing field, so the check shall be done before the ACK deadline (1,7ms) :
+ * the membership bitmap built by Konnekting gives the answer in constant time,
+ * the com objects list is only resolved later, when the telegram is processed (see getAddressedComObjects())
  * 
  * WARNING: DO NOT ADD DEBUG CODE HERE, AS IT WILL BREAK TELEGRAM RECEIVIBG (Timing issues)
  * 
  * @param addr the GA to check for assignment
- * @param index the index variable will be filled with the index matching this GA
- * @return true if assigned & active, false if not
+ * @return true if assigned, false if not
  */
 boolean KnxTpUart::isAddressAssigned(word addr) {
-    //long start = micros();
-    //DEBUG_PRINTLN(F("isAddressAssigned: Searching for 0x%04x"), addr);
+    // Programming Group Address
+    if (addr == 0x7fff) return true;  // 0x7fff = 15/7/255
+
+    if (!_assignedComObjectsNb) return false;
 
-    // clean up old findings
-    _addressedComObjects.items = 0;
+    if (Konnekting._addressFilter.available) return isAddressInFilter(Konnekting._addressFilter, addr);
+
+    // no bitmap available (not enough memory), fall back to the tables search
+    return (getAddressedComObjects(addr).items > 0);
+}
+
+/**
+ * Get the com objects assigned to the target address
+ * The address id is searched in the address table, then the com objects are given
+ * by the slice of the association index for this address id (no copy)
+ * 
+ * @param addr the GA to search for
+ * @return the list of the assigned com objects indexes (items = 0 if the GA is not assigned)
+ */
+AddressedComObjects KnxTpUart::getAddressedComObjects(word addr) const {
+    static const byte progComObjList[1] = {255};
+    AddressedComObjects addressedComObjects = {0, NULL};
 
     // in case of Programming Group Address, we also return immediately
-    if (addr == 0x7fff) {                    // 0x7fff = 15/7/255
-        _addressedComObjects.list[0] = 255;  // set ProgComObj
-        _addressedComObjects.items = 1;
-        //DEBUG_PRINTLN(F("  0x%04x == 0x7fff --> progComObj. [%dus]"), addr, (micros() - start));
-        return true;
+    if (addr == 0x7fff) {  // 0x7fff = 15/7/255
+        addressedComObjects.items = 1;
+        addressedComObjects.list = progComObjList;  // set ProgComObj
+        return addressedComObjects;
     }
 
-    // get address and association table from konnekting
-    AddressTable addressTable = Konnekting._addressTable;
-    AssociationTable associationTable = Konnekting._associationTable;
+    // get address table and association index from konnekting
+    const AddressTable& addressTable = Konnekting._addressTable;
+    const AssociationIndex& associationIndex = Konnekting._associationIndex;
 
-    // in case of empty COM-Flagged ComObj list or empty association or address list, we return immediately
-    if (!_assignedComObjectsNb || addressTable.size == 0 || associationTable.size == 0) return false;
-
-    // search for adressid in address table
-    byte l = 0;                                    // left end of array
-    byte r = addressTable.size - 1;  // right end of array
-    boolean addressFound = false;    // true if address found in address table
-    byte addressId;                  // address-id of groupaddress in address table
+    // in case of empty COM-Flagged ComObj list or empty address list, we return immediately
+    if (!_assignedComObjectsNb || addressTable.size == 0 || associationIndex.offset == NULL) return addressedComObjects;
 
     // do binary search in address table
+    int l = 0;                      // left end of array
+    int r = addressTable.size - 1;  // right end of array
     while (l <= r) {
-        byte m = l + (r - l) / 2;  // mid
+        int m = l + (r - l) / 2;  // mid
 
         // Check if 'addr' is present at mid
         if (addressTable.address[m] == addr) {
-            addressFound = true;
-            addressId = m;
+            // the com objects of address id m are coId[offset[m]] to coId[offset[m+1]-1]
+            addressedComObjects.items = associationIndex.offset[m + 1] - associationIndex.offset[m];
+            addressedComObjects.list = &Konnekting._associationTable.coId[associationIndex.offset[m]];
             break;
         }
 
@@ -574,97 +761,6 @@ boolean KnxTpUart::isAddressAssigned(word addr) {
             r = m - 1;
         }
     }
-    if (!addressFound) {
-        //        DEBUG_PRINTLN(F("  0x%04x not in addr table. [%dus]"), addr, (micros() - start));
-        return false;  // address unknown
-    } else {
-        //        DEBUG_PRINTLN(F("  0x%04x has id #%d"), addr, addressId);
-    }
-
-    // We handle the assoc table from konnkting as two arrays
-    // to make search for GA easier, as we can search in an
-    // AddressId-Array-Only for the matching index and can use the ComObj
-    // array to get the ComObjID based on the found index
-
-    // inspired by https://www.geeksforgeeks.org/binary-search/
-    l = 0;                          // left end of array
-    r = associationTable.size - 1;  // right end of array
-
-    // some helper variables for doing iterative binary search
-    int addressIdOnIndex = 0;
-    boolean addressIdFound = false;
-
-    // do binary search in assoc table
-    while (l <= r) {
-        byte m = l + (r - l) / 2;  // mid
-
-        // Check if 'addressId' is present at mid
-        if (associationTable.gaId[m] == addressId) {
-            addressIdFound = true;
-            addressIdOnIndex = m;
-            break;
-        }
-
-        // If 'addressId' greater, ignore left half by setting l to next right from mid
-        if (addressId > associationTable.gaId[m]) {
-            l = m + 1;
-        } else {
-            // 'addressId' is smaller, so ignore right half by setting r to next left from mid
-            r = m - 1;
-        }
-    }
-
-    byte listIndex = 0;
-
-    if (addressIdFound) {
-                // DEBUG_PRINTLN(F("  addrID=%d found on assoc table index %d"), addressId, addressIdOnIndex);
-
-        // add first occurence
-        _addressedComObjects.list[listIndex] = associationTable.coId[addressIdOnIndex];
-        _addressedComObjects.items++;
-        listIndex++;
-
-        // search backwards until other address gets visible
-        byte i = addressIdOnIndex - 1;
-
-        if (i >= 0) {
-            while (associationTable.gaId[i] == addressId) {
-                //                DEBUG_PRINTLN(F("    found prev index: %d"), i);
-
-                _addressedComObjects.list[listIndex] = associationTable.coId[i];
-                _addressedComObjects.items++;
-                listIndex++;
-                
-                if(i == 0)  // stop when bottom of the table is reached, otherwise it will wrap around and search at index 255 even it does not exist
-                    break;
-                i--;
-            }
-        }
-
-        // search forward until other address gets visible
-        i = addressIdOnIndex + 1;
-        if (i <= associationTable.size - 1) {
-            while (associationTable.gaId[i] == addressId) {
-                //                DEBUG_PRINTLN(F("    found next index: %d"), i);
-                _addressedComObjects.list[listIndex] = associationTable.coId[i];
-                _addressedComObjects.items++;
-                listIndex++;
-
-                if(i == associationTable.size - 1)  // stop when top of the table is reached
-                    break;
-                i++;
-            }
-        }
-    }
-
-    boolean foundSomeIndex = _addressedComObjects.items > 0;
-
-    if (!foundSomeIndex) {
-        //        DEBUG_PRINTLN(F("IsAddressAssigned: found nothing, skipping this GA"), addr);
-    } else {
-        //DEBUG_PRINTLN(F("IsAddressAssigned: found %d matching ComObjs"), _addressedComObjects.items);
-    }
-    //DEBUG_PRINTLN(F("IsAddressAssigned: [%dus]"), (micros() - start));
-    return foundSomeIndex;
+    return addressedComObjects;
 }
 //EOF
@@ -23,6 +23,7 @@
 #include "HardwareSerial.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
+#include "KnxRxRing.h"
 #include "System.h"
 
 
@@ -47,9 +48,11 @@
 #define TPUART_SET_ADDR_REQ                  0x28
 #define TPUART_DATA_START_CONTINUE_REQ       0x80
 #define TPUART_DATA_END_REQ                  0x40
+#define TPUART_DATA_OFFSET_REQ               0x08 // + (index >> 6), for the bytes beyond index 63 of the extended telegrams
 #define TPUART_ACTIVATEBUSMON_REQ            0x05
 #define TPUART_RX_ACK_SERVICE_ADDRESSED      0x11
 #define TPUART_RX_ACK_SERVICE_NOT_ADDRESSED  0x10
+#define TPUART_RX_ACK_SERVICE_BUSY           0x13
 
 
 // Services from TPUART (TPUART -> hostcontroller) :
@@ -62,9 +65,9 @@
 #define TPUART_DATA_CONFIRM_FAILED            0x0B
 #define TPUART_STATE_INDICATION               0x07
 #define TPUART_STATE_INDICATION_MASK          0x07
-#define KNX_CONTROL_FIELD_PATTERN_MASK   B11010011 // 0xD3
-#define KNX_CONTROL_FIELD_VALID_PATTERN  B10010000 // 0x90, Only Standard Frame Format "10" is handled
-#define KNX_PAYLOAD_LENGTH_MASK          B00001111 // 0x0F, last 4 bits, only Standard Frame is supported
+#define KNX_CONTROL_FIELD_PATTERN_MASK   B01010011 // 0x53
+#define KNX_CONTROL_FIELD_VALID_PATTERN  B00010000 // 0x10, Standard "10" and Extended "00" Frame Formats are handled
+#define KNX_PAYLOAD_LENGTH_MASK          B00001111 // 0x0F, last 4 bits of the routing field (Standard Frame)
 
 
 // Mask for STATE INDICATION service
@@ -83,6 +86,32 @@
 #define KNX_RECEPTION_TIMEOUT 2000
 #endif
 
+// Nb of slots of the received telegrams queue (2 to 16)
+// NB : one slot is always kept free for the telegram being received
+#ifndef KNX_RX_QUEUE_SIZE
+#define KNX_RX_QUEUE_SIZE 4
+#endif
+
+#if (KNX_RX_QUEUE_SIZE < 2) || (KNX_RX_QUEUE_SIZE > 16)
+#error "KNX_RX_QUEUE_SIZE shall be between 2 and 16"
+#endif
+
+// RX budget of one rxTask() call : max nb of bytes read in a row, and max processing time (us)
+// NB : a budget of 1 byte gives back the former "one byte per call" behaviour
+#ifndef KNX_RX_BUDGET_BYTES
+#define KNX_RX_BUDGET_BYTES 32
+#endif
+#ifndef KNX_RX_BUDGET_TIME
+#define KNX_RX_BUDGET_TIME 1000
+#endif
+
+// TX burst : max nb of bytes in the UART TX buffer up to which txTask() sends telegram pieces (0 : one piece per call)
+// As the bytes already buffered go out before an ACK service (0,58ms per byte), the buffer shall be empty
+// before the 7th byte of a telegram received meanwhile, i.e. 8ms after its control field
+#ifndef KNX_TX_BURST_BYTES
+#define KNX_TX_BURST_BYTES 12
+#endif
+
 // Definition of the TP-UART working modes
 enum KnxTpUartMode { NORMAL,
                           BUS_MONITOR };
@@ -95,8 +124,11 @@ enum KnxTpUartEvent {
   TPUART_EVENT_STATE_INDICATION = 3             // 3: new TPUART state indication received
  };
 
+class KnxTpUart;
+
 // Typedef for events callback function
-typedef void (*EventCallbackFctPtr) (KnxTpUartEvent);
+// The TPUART raising the event is given, so that one callback can serve several TPUARTs
+typedef void (*EventCallbackFctPtr) (KnxTpUart&, KnxTpUartEvent);
 
 // --- Definitions for the RECEPTION part ----
 // RX states
@@ -112,15 +144,33 @@ enum TpUartRxState {
 };
 
 typedef struct AddressedComObjects {
-  byte size; // total size of list, incl. empty cells
-  byte items; // size if items in list
-  byte* list; // the list/array if indizes of addressed comcobjects
+  byte items;       // nb of items in list
+  const byte* list; // the list/array of indizes of addressed comobjects (slice of the association table, not to be modified)
 } AddressedComObjects;
 
+// --- Typdef for BUS MONITORING mode data ----
+typedef struct MonitorData {
+  boolean isEOP;  // True if the data is an End Of Packet
+  byte dataByte;  // Last data retrieved on the bus (valid when isEOP is false)
+  word timestamp; // Reception time (in usec) of the data byte (of the last byte in case of EOP)
+} MonitorData;
+
 typedef struct TpUartRx {
   TpUartRxState state;        // Current TPUART RX state
-  KnxTelegram receivedTelegram; // Where each received telegram is stored (the content is overwritten on each telegram reception)
-                                // A TPUART_EVENT_RECEIVED_KNX_TELEGRAM event notifies each content change
+  KnxTelegram queue[KNX_RX_QUEUE_SIZE]; // Queue of received telegrams, each telegram is received directly in the slot at tail
+                                        // A TPUART_EVENT_RECEIVED_KNX_TELEGRAM event notifies each new queued telegram
+  byte head;                  // Slot of the oldest received telegram
+  byte tail;                  // Free slot, where the next telegram is received
+  byte count;                 // Nb of received telegrams in the queue (taken ones included)
+  byte takenNb;               // Nb of telegrams taken from head (being processed)
+  word releasedMask;          // Taken telegrams (1 bit per slot) released before the ones received earlier
+  KnxTelegramValidator validator; // Validation of the telegram being received, updated on each received byte
+  word readBytesNb;           // Nb of read bytes during an KNX telegram reception
+  word expectedTelegramLength; // Index of the checksum byte of the telegram being received (0 if not known yet)
+  boolean telegramCompletelyReceived; // True when the checksum byte of the telegram has been received
+  word lastByteRxTime;        // Reception time (in usec) of the last received byte
+  word busBytesNb;            // Nb of telegram bytes seen on the bus (all the telegrams, our own ones included), wraps around
+  MonitorData monitorData;    // Last data got in BUS MONITORING mode
 } TpUartRx;
 
 // --- Definitions for the TRANSMISSION  part ----
@@ -143,24 +193,22 @@ enum TpUartTxAck {
 };
 
 // Typedef for TX acknowledge callback function
-typedef void (*AckCallbackFctPtr) (TpUartTxAck);
+typedef void (*AckCallbackFctPtr) (KnxTpUart&, TpUartTxAck);
 
 typedef struct TpUartTx {
   TpUartTxState state;            // Current TPUART TX state
   KnxTelegram *sentTelegram;        // Telegram being sent
   AckCallbackFctPtr ackFctPtr; // Pointer to callback function for TX ack
-  byte nbRemainingBytes;            // Nb of bytes remaining to be transmitted
-  byte txByteIndex;                 // Index of the byte to be sent
+  word nbRemainingBytes;            // Nb of bytes remaining to be transmitted
+  word txByteIndex;                 // Index of the byte to be sent
+  word sentMessageTime;             // Time (in msec) of the end of the telegram sending, for the ACK timeout
+  int bufferSize;                   // Size of the UART TX buffer (max free space seen), for the burst mode
 } TpUartTx;
 
 
-// --- Typdef for BUS MONITORING mode data ----
-typedef struct MonitorData {
-  boolean isEOP;  // True if the data is an End Of Packet
-  byte dataByte;  // Last data retrieved on the bus (valid when isEOP is false)
-} MonitorData;
-
 class KnxTpUart {
+    friend class KnxHostTest;  // host side tests (extras/test)
+
     HardwareSerial& _serial;                  // Arduino HW serial port connected to the TPUART
     const word _physicalAddr;                 // Physical address set in the TP-UART
     const KnxTpUartMode _mode;           // TpUart working Mode (Normal/Bus Monitor)
@@ -170,6 +218,7 @@ class KnxTpUart {
     KnxComObject *_comObjectsList;            // Attached list of com objects
     byte _assignedComObjectsNb;               // Nb of assigned com objects
     byte _stateIndication;                    // Value of the last received state indication
+    KnxRxRing *_rxRing;                       // Optional ring fed by the UART RX interrupt (NULL : the serial port is polled)
 
   public:  
   
@@ -197,19 +246,47 @@ class KnxTpUart {
     // NB : every state indication value change is notified by a "TPUART_EVENT_STATE_INDICATION" event
     byte getStateIndication(void) const;
 
-    // Get the reference to the telegram received by the TPUART
-    // NB : every received telegram content change is notified by a "TPUART_EVENT_RECEIVED_KNX_TELEGRAM" event
-    KnxTelegram& getReceivedTelegram(void);
+    // Get the physical address set in the TPUART
+    word getPhysicalAddress(void) const;
+
+    // Get the nb of telegram bytes seen on the bus since the TPUART creation (wraps around)
+    // NB : used to estimate the bus load
+    word getBusBytesNb(void) const;
+
+    // Take the oldest received telegram (not taken yet) from the RX queue, NULL if there's none
+    // NB : every new received telegram is notified by a "TPUART_EVENT_RECEIVED_KNX_TELEGRAM" event
+    // The telegram stays in the queue (no copy) and shall be released with releaseReceivedTelegram() once processed
+    KnxTelegram* takeReceivedTelegram(void);
 
-    // Get the index of the com object targeted by the last received telegram
-    //byte GetTargetedComObjectIndex(void) const;
-    AddressedComObjects getAddressedComObjects(void) const;
+    // Release a telegram got with takeReceivedTelegram(), its slot is given back to the reception
+    void releaseReceivedTelegram(KnxTelegram* telegram);
+
+    // Get the indexes of the com objects targeted by a GA or by a received telegram
+    // NB : the list points to the association table, it remains valid as long as the tables are not reloaded
+    AddressedComObjects getAddressedComObjects(word addr) const;
+    AddressedComObjects getAddressedComObjects(const KnxTelegram& telegram) const;
 
     // returns true if there is an activity ongoing (RX/TX) on the TPUART
     // false when there's no activity or when the tpuart is not initialized
     boolean isActive(void) const;
 
+    // returns true if rxTask() shall be called periodically, i.e. when the received bytes are polled from the serial,
+    // when a telegram is being received (EOP detection) or when received bytes are pending in the RX ring
+    // false when the RX ring is attached and empty, the UART RX interrupt then tells when a byte comes
+    boolean isRxPollingRequired(void) const;
+
+    // returns true if the RX queue is full, the telegrams addressed to us are then answered BUSY
+    // till the device releases the queued ones
+    boolean isRxQueueFull(void) const;
+
   // Functions NOT INLINED
+    // Attach a ring fed by the UART RX interrupt (NULL to detach and come back to serial polling)
+    // When a ring is attached, all the received data are read from the ring and each byte comes with its reception time,
+    // so the End Of Packet detection no longer depends on the rxTask() calling period
+    // NB : the interrupt routine shall call ring.push(byte) for every byte received from the TPUART
+    // The function must be called prior to reset() execution
+    void attachRxRing(KnxRxRing* ring);
+
     // Reset the Arduino UART port and the TPUART device
     // Return KNX_TPUART_ERROR in case of TPUART reset failure
     byte reset(void);
@@ -237,6 +314,12 @@ class KnxTpUart {
     // is transmitted in 0,58ms.
     // In order not to miss any End Of Packets (i.e. a gap from 2 to 2,5ms), the function shall be called at a max period of 0,5ms.
     // Typical calling period is 400 usec.
+    // NB : a telegram is completed as soon as its checksum byte (given by the routing field length) is received,
+    // the End Of Packet timeout only applies to truncated telegrams
+    // NB : when an RX ring is attached (see attachRxRing()), the EOP is detected from the bytes timestamps and the calling
+    // period is no longer bound to 0,5ms; it shall remain short enough to send the ACK in time (i.e. 1,7ms after the address)
+    // NB : all the pending bytes are processed at each call, within the KNX_RX_BUDGET_BYTES/KNX_RX_BUDGET_TIME limits,
+    // so that bytes accumulated in the UART buffer (e.g. after a long user routine) are caught up at once
     void rxTask(void);
 
     // Transmission task
@@ -251,18 +334,29 @@ class KnxTpUart {
     // Get Bus monitoring data (BUS MONITORING mode)
     // The function returns true if a new data has been retrieved (data pointer in argument), else false
     // It shall be called periodically (max period of 0,5ms) in order to allow correct data reception
-    // Typical calling period is 400 usec.
+    // Typical calling period is 400 usec. (no constraint on the period when an RX ring is attached)
     boolean getMonitoringData(MonitorData&);
 
   private:
 
-    AddressedComObjects _addressedComObjects;
-
   // Private NOT INLINED functions 
     // Check if the target address points to an assigned com object (i.e. the target address equals a com object address)
-    // if yes, then update index parameter with the index (in the list) of the targeted com object and return true
-    // else return false
+    // return true if yes, else false (constant time check used for the ACK decision)
     boolean isAddressAssigned(word addr);
+
+    // Returns true if received data are available (from the RX ring if attached, else from the serial port)
+    boolean rxAvailable(void);
+
+    // Read a received byte and its reception time (in usec)
+    // the reception time is the interrupt time when the RX ring is attached, else the current time
+    byte rxRead(word& timestamp);
+
+    // Check if txTask() can send a telegram piece, after the sentPiecesNb ones of the same call
+    boolean txBurstAllowed(byte sentPiecesNb);
+
+    // End of telegram handling, called when the last byte of the telegram has been received (complete = true)
+    // or when the reception timeout elapsed before (complete = false)
+    void rxEndOfTelegram(boolean complete);
 };
 
 
@@ -284,14 +378,31 @@ inline byte KnxTpUart::setAckCallback(AckCallbackFctPtr ackFctPtr)
   return KNX_TPUART_OK;
 }
 
+inline void KnxTpUart::attachRxRing(KnxRxRing* ring) { _rxRing = ring; }
+
+inline boolean KnxTpUart::rxAvailable(void)
+{
+  if (_rxRing) return (_rxRing->available() > 0);
+  return (_serial.available() > 0);
+}
+
 inline byte KnxTpUart::getStateIndication(void) const { return _stateIndication; }
 
-inline KnxTelegram& KnxTpUart::getReceivedTelegram(void)
-{ return _rx.receivedTelegram; }
+inline word KnxTpUart::getPhysicalAddress(void) const { return _physicalAddr; }
+
+inline word KnxTpUart::getBusBytesNb(void) const { return _rx.busBytesNb; }
+
+inline boolean KnxTpUart::isRxQueueFull(void) const { return (_rx.count == KNX_RX_QUEUE_SIZE - 1); }
+
+inline boolean KnxTpUart::isRxPollingRequired(void) const
+{
+  if (!_rxRing) return true;
+  return ((_rx.state >= RX_KNX_TELEGRAM_RECEPTION_STARTED) || (_rxRing->available() > 0));
+}
 
 
-inline AddressedComObjects KnxTpUart::getAddressedComObjects(void) const
-{ return _addressedComObjects; }
+inline AddressedComObjects KnxTpUart::getAddressedComObjects(const KnxTelegram& telegram) const
+{ return getAddressedComObjects(telegram.getTargetAddress()); }
 
 
 inline boolean KnxTpUart::isActive(void) const
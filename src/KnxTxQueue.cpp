@@ -0,0 +1,118 @@
+/*!
+ * @file KnxTxQueue.cpp
+ *
+ * @section author Author
+ *
+ * Written by Alexander Christian.
+ *
+ * @section license License
+ *
+ *    Copyright (C) 2016 Alexander Christian <info(at)root1.de>. All rights
+ *    reserved. This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute
+ *    it and/or modify it under the terms of the GNU General Public License as
+ *    published by the Free Software Foundation, either version 3 of the License,
+ *    or (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "KnxTxQueue.h"
+
+// Constructor, all the slots are free
+KnxTxQueue::KnxTxQueue() {
+    for (byte i = 0; i < ACTIONS_QUEUE_SIZE; i++) _next[i] = i + 1;
+    _next[ACTIONS_QUEUE_SIZE - 1] = KNX_TX_QUEUE_NONE;
+    _free = 0;
+    for (byte level = 0; level < KNX_TX_LEVELS_NB; level++) {
+        _head[level] = KNX_TX_QUEUE_NONE;
+        _tail[level] = KNX_TX_QUEUE_NONE;
+        _waited[level] = 0;
+    }
+    _itemCount = 0;
+    _maxItemCount = 0;
+}
+
+byte KnxTxQueue::append(const TxAction& action, byte level) {
+    if (_free == KNX_TX_QUEUE_NONE) return KNX_TX_QUEUE_NONE;
+    byte slot = _free;
+    _free = _next[slot];
+    _actions[slot] = action;
+    _next[slot] = KNX_TX_QUEUE_NONE;
+    if (_tail[level] == KNX_TX_QUEUE_NONE) _head[level] = slot;
+    else _next[_tail[level]] = slot;
+    _tail[level] = slot;
+    _itemCount++;
+    if (_itemCount > _maxItemCount) _maxItemCount = _itemCount;
+    return slot;
+}
+
+boolean KnxTxQueue::popAllowed(TxAction& action, byte allowedLevels) {
+    byte level, served = KNX_TX_QUEUE_NONE;
+
+    // the highest non empty allowed level, unless a NORMAL action has waited too long behind HIGH ones
+    // (no promotion while a SYSTEM or ALARM action is queued, even if its level is not allowed yet,
+    // so that the starvation protection never lets an action pass an alarm)
+    for (level = 0; level < KNX_TX_LEVELS_NB; level++) {
+        if ((allowedLevels & (1 << level)) && (_head[level] != KNX_TX_QUEUE_NONE)) {
+            served = level;
+            break;
+        }
+    }
+    if (served == KNX_TX_QUEUE_NONE) return false;
+    if ((served >= KNX_TX_LEVEL_HIGH) && (_head[KNX_TX_LEVEL_SYSTEM] == KNX_TX_QUEUE_NONE) && (_head[KNX_TX_LEVEL_ALARM] == KNX_TX_QUEUE_NONE)) {
+        for (level = KNX_TX_LEVEL_NORMAL; level > served; level--) {
+            if ((allowedLevels & (1 << level)) && (_head[level] != KNX_TX_QUEUE_NONE) && (_waited[level] >= KNX_TX_STARVATION_LIMIT)) {
+                served = level;
+                break;
+            }
+        }
+    }
+
+    // the lower levels which are not served wait once more
+    for (level = served + 1; level < KNX_TX_LEVELS_NB; level++) {
+        if ((_head[level] != KNX_TX_QUEUE_NONE) && (_waited[level] < 255)) _waited[level]++;
+    }
+    _waited[served] = 0;
+    return pop(action, served);
+}
+
+boolean KnxTxQueue::pop(TxAction& action, byte level) {
+    byte slot = _head[level];
+    if (slot == KNX_TX_QUEUE_NONE) return false;
+    action = _actions[slot];
+    _head[level] = _next[slot];
+    if (_head[level] == KNX_TX_QUEUE_NONE) {
+        _tail[level] = KNX_TX_QUEUE_NONE;
+        _waited[level] = 0;
+    }
+    _next[slot] = _free;
+    _free = slot;
+    _itemCount--;
+    return true;
+}
+
+byte KnxTxQueue::find(const TxAction& action, byte level) const {
+    byte found = KNX_TX_QUEUE_NONE;
+    for (byte slot = _head[level]; slot != KNX_TX_QUEUE_NONE; slot = _next[slot]) {
+        if ((_actions[slot].command == action.command) && (_actions[slot].index == action.index)) found = slot;
+    }
+    return found;
+}
+
+byte KnxTxQueue::getItemCount(byte level) const {
+    byte count = 0;
+    for (byte slot = _head[level]; slot != KNX_TX_QUEUE_NONE; slot = _next[slot]) count++;
+    return count;
+}
+
+// EOF
@@ -0,0 +1,150 @@
+/*
+ *    This file is part of KONNEKTING Device Library.
+ *
+ *    The KONNEKTING Device Library is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KNXTXQUEUE_H
+#define KNXTXQUEUE_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+
+// Nb of TX actions the queue can hold (all priorities together, 255 max)
+#ifndef ACTIONS_QUEUE_SIZE
+#define ACTIONS_QUEUE_SIZE 16
+#endif
+
+#if (ACTIONS_QUEUE_SIZE < 1) || (ACTIONS_QUEUE_SIZE > 255)
+#error "ACTIONS_QUEUE_SIZE shall be between 1 and 255"
+#endif
+
+// Nb of actions served from a higher level while an action of the NORMAL level is waiting, before the waiting
+// one is served ahead of the HIGH level (starvation protection, never done while a SYSTEM or ALARM action is queued)
+#ifndef KNX_TX_STARVATION_LIMIT
+#define KNX_TX_STARVATION_LIMIT 8
+#endif
+
+// Levels of the TX queue, in serving order
+#define KNX_TX_LEVEL_SYSTEM 0
+#define KNX_TX_LEVEL_ALARM  1
+#define KNX_TX_LEVEL_HIGH   2
+#define KNX_TX_LEVEL_NORMAL 3
+#define KNX_TX_LEVELS_NB    4
+
+#define KNX_TX_QUEUE_NONE 255 // end of list
+
+// Max size of a com object value (A112 format, i.e. 14 bytes)
+#define KNX_TX_ACTION_VALUE_SIZE 14
+
+// Action types
+enum TxActionType {
+  KNX_READ_REQUEST,
+  KNX_WRITE_REQUEST,
+  KNX_RESPONSE_REQUEST
+};
+
+typedef struct TxAction{
+  TxActionType command; // Action type to be performed
+  byte index; // Index of the involved ComObject
+  union { // Value
+    // Field used in case of short value (value width <= 1 byte)
+    struct {
+      byte byteValue;
+      byte notUsed;
+    };
+    byte longValue[KNX_TX_ACTION_VALUE_SIZE]; // Field used in case of long value (width > 1 byte), stored inline (no dynamic allocation)
+  };
+} TxAction;
+
+// Level of the TX queue for a KNX priority
+inline byte KnxTxLevel(e_KnxPriority priority) {
+  switch (priority) {
+    case KNX_PRIORITY_SYSTEM_VALUE : return KNX_TX_LEVEL_SYSTEM;
+    case KNX_PRIORITY_ALARM_VALUE : return KNX_TX_LEVEL_ALARM;
+    case KNX_PRIORITY_HIGH_VALUE : return KNX_TX_LEVEL_HIGH;
+    default : return KNX_TX_LEVEL_NORMAL;
+  }
+}
+
+/**
+ * Queue of the TX actions with one FIFO per KNX priority level
+ * 
+ * The actions are stored in a common pool of ACTIONS_QUEUE_SIZE slots, each level being a linked list of slots,
+ * so the queue doesn't take more memory than a single FIFO.
+ * pop() always serves the highest priority level first (SYSTEM, ALARM, HIGH then NORMAL), but an action of the
+ * NORMAL level which has waited for KNX_TX_STARVATION_LIMIT actions is served before the HIGH level ones.
+ * There's no such promotion while a SYSTEM or ALARM action is queued : these levels are never passed.
+ */
+class KnxTxQueue {
+    TxAction _actions[ACTIONS_QUEUE_SIZE]; // pool of actions
+    byte _next[ACTIONS_QUEUE_SIZE];        // next slot in the list (level FIFO or free list)
+    byte _head[KNX_TX_LEVELS_NB];          // oldest action of each level
+    byte _tail[KNX_TX_LEVELS_NB];          // newest action of each level
+    byte _waited[KNX_TX_LEVELS_NB];        // nb of actions served while the level was waiting
+    byte _free;                            // first free slot
+    byte _itemCount;
+    byte _maxItemCount;                    // high-water mark of _itemCount
+
+  public:
+    KnxTxQueue();
+
+    /**
+     * Append an action at the end of its level FIFO
+     * @return the slot of the action, KNX_TX_QUEUE_NONE if the queue is full (the action is not queued)
+     */
+    byte append(const TxAction& action, byte level);
+
+    /**
+     * Access to a queued action (e.g. to update it in place)
+     * NB : do not check that the slot is in use
+     */
+    TxAction& getAction(byte slot) { return _actions[slot]; }
+
+    /**
+     * Find the newest action of a level with the same command and com object index as the given one
+     * @return the slot of the action, KNX_TX_QUEUE_NONE if not found
+     */
+    byte find(const TxAction& action, byte level) const;
+
+    /**
+     * Pop the next action to be sent
+     * @return false if the queue is empty
+     */
+    boolean pop(TxAction& action) { return popAllowed(action, 0xFF); }
+
+    /**
+     * Pop the next action to be sent among the allowed levels (bit i for level i)
+     * @return false if the allowed levels are empty
+     */
+    boolean popAllowed(TxAction& action, byte allowedLevels);
+
+    /**
+     * Pop the oldest action of a level
+     * @return false if the level is empty
+     */
+    boolean pop(TxAction& action, byte level);
+
+    byte getItemCount(void) const { return _itemCount; }
+
+    byte getItemCount(byte level) const;
+
+    boolean isFull(void) const { return (_itemCount == ACTIONS_QUEUE_SIZE); }
+
+    byte getMaxItemCount(void) const { return _maxItemCount; }
+
+    void resetMaxItemCount(void) { _maxItemCount = _itemCount; }
+};
+
+#endif // KNXTXQUEUE_H
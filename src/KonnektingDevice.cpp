@@ -74,7 +74,8 @@ KonnektingDevice &Konnekting = KonnektingDevice::Konnekting;  // maybe this line
 // init static members, see https://thinkingeek.com/2012/08/08/common-linking-issues-c/
 AssociationTable KonnektingDevice::_associationTable;
 AddressTable KonnektingDevice::_addressTable;
-byte KonnektingDevice::_assocMaxTableEntries = 0;
+AssociationIndex KonnektingDevice::_associationIndex;
+AddressFilter KonnektingDevice::_addressFilter;
 // ---------------
 
 /**************************************************************************/
@@ -280,36 +281,10 @@ void KonnektingDevice::internalInit(HardwareSerial &serial, word manufacturerID,
             _associationTable.gaId = (byte *)malloc(_associationTable.size * sizeof(byte));
             _associationTable.coId = (byte *)malloc(_associationTable.size * sizeof(byte));
 
-            int overallMax = 0;
-            int currentMax = 0;
-            int currentAddrId = 0;
-            bool is1stAddrId = true; // when we start, we need a flag to detect the start to set the first id for addressId comparison 
-
             for (byte i = 0; i < _associationTable.size; i++) {
                 byte addressId = memoryRead(KONNEKTING_MEMORYADDRESS_ASSOCIATIONTABLE + 1 + (i * 2));
                 byte commObjectId = memoryRead(KONNEKTING_MEMORYADDRESS_ASSOCIATIONTABLE + 1 + (i * 2) + 1);
 
-                if (is1stAddrId) {
-                    currentAddrId = addressId;
-                    is1stAddrId = false;
-                }
-
-                if (currentAddrId == addressId) {
-                    currentMax++; // increase counter for current GA association count
-
-                } else {  // different GA detected
-                    currentMax = 1; // found different GA association, so we found 1 assoc for this GA so far
-                    currentAddrId = addressId; // remember that we are currently counting for this address
-
-                }
-                //DEBUG_PRINTLN(F("  currentMax=%d"), currentMax);
-
-                // if the last known currentMax is bigger than the overallMax, replace overallMax
-                if (currentMax > overallMax) {
-                    overallMax = currentMax;
-                    //DEBUG_PRINTLN(F("  new overallMax=%d"), overallMax);
-                }
-
                 // store copy of association table in RAM
                 _associationTable.gaId[i] = addressId;
                 _associationTable.coId[i] = commObjectId;
@@ -321,8 +296,7 @@ void KonnektingDevice::internalInit(HardwareSerial &serial, word manufacturerID,
 
                 Knx.setComObjectAddress(commObjectId, ga);
             }
-            _assocMaxTableEntries = overallMax;
-            DEBUG_PRINTLN(F("Reading association table...*done* _assocMaxTableEntries=%d"), _assocMaxTableEntries);
+            DEBUG_PRINTLN(F("Reading association table...*done*"));
         }
         
         // params are read either on demand or in setup() and not on init() ...
@@ -339,6 +313,9 @@ void KonnektingDevice::internalInit(HardwareSerial &serial, word manufacturerID,
         
     }
 
+    buildAssociationIndex();
+    buildAddressFilter();
+
     DEBUG_PRINTLN(F("IA: 0x%04x"), _individualAddress);
     KnxDeviceStatus status;
     status = Knx.begin(serial, _individualAddress);
@@ -358,6 +335,91 @@ void KonnektingDevice::internalInit(HardwareSerial &serial, word manufacturerID,
     _rebootRequired = false;
 }
 
+/**************************************************************************/
+/*!
+ *  @brief  Build the index of the association table per address id.
+ *          The association table is sorted by address id (stable insertion sort,
+ *          linear when the table is already sorted), then the offset of the
+ *          first association of each address id is stored, so that the com objects
+ *          of a GA are a single slice of the association table.
+ *  @return void
+ */
+/**************************************************************************/
+void KonnektingDevice::buildAssociationIndex() {
+    // sort the association table by address id
+    for (byte i = 1; i < _associationTable.size; i++) {
+        byte gaId = _associationTable.gaId[i];
+        byte coId = _associationTable.coId[i];
+        byte j = i;
+        for (; (j > 0) && (_associationTable.gaId[j - 1] > gaId); j--) {
+            _associationTable.gaId[j] = _associationTable.gaId[j - 1];
+            _associationTable.coId[j] = _associationTable.coId[j - 1];
+        }
+        _associationTable.gaId[j] = gaId;
+        _associationTable.coId[j] = coId;
+    }
+
+    free(_associationIndex.offset);
+    _associationIndex.offset = (byte *)malloc(_addressTable.size + 1);
+    if (_associationIndex.offset == NULL) {
+        DEBUG_PRINTLN(F("AssociationIndex: not enough memory"));
+        return;
+    }
+
+    // offset[n] = nb of associations with an address id lower than n
+    byte assocIndex = 0;
+    for (int addressId = 0; addressId <= _addressTable.size; addressId++) {
+        while ((assocIndex < _associationTable.size) && (_associationTable.gaId[assocIndex] < addressId)) assocIndex++;
+        _associationIndex.offset[addressId] = assocIndex;
+    }
+}
+
+/**************************************************************************/
+/*!
+ *  @brief  Build the membership bitmap of the assigned group addresses
+ *          from the address and association tables.
+ *          Level 1 has one bit per GA high byte, level 2 has a 32 bytes page
+ *          (one bit per GA low byte) for each high byte in use.
+ *          If the pages can't be allocated, the filter is marked as not available
+ *          and the TPUART falls back to the table search.
+ *  @return void
+ */
+/**************************************************************************/
+void KonnektingDevice::buildAddressFilter() {
+    byte pagesNb = 0;
+
+    free(_addressFilter.pages);
+    _addressFilter.pages = NULL;
+    _addressFilter.available = false;
+    memset(_addressFilter.hiMap, 0, sizeof(_addressFilter.hiMap));
+
+    // level 1 : high bytes in use
+    for (byte i = 0; i < _associationTable.size; i++) {
+        byte gaHi = HI__(_addressTable.address[_associationTable.gaId[i]]);
+        _addressFilter.hiMap[gaHi >> 3] |= (1 << (gaHi & 7));
+    }
+    for (byte i = 0; i < sizeof(_addressFilter.hiMap); i++) {
+        _addressFilter.hiRank[i] = pagesNb;
+        for (byte map = _addressFilter.hiMap[i]; map; map &= (map - 1)) pagesNb++;
+    }
+
+    // level 2 : low bytes of each high byte in use
+    if (pagesNb) {
+        _addressFilter.pages = (byte *)calloc(pagesNb, 32);
+        if (_addressFilter.pages == NULL) {
+            DEBUG_PRINTLN(F("AddressFilter: not enough memory for %d pages"), pagesNb);
+            return;
+        }
+        for (byte i = 0; i < _associationTable.size; i++) {
+            word ga = _addressTable.address[_associationTable.gaId[i]];
+            byte* page = getAddressFilterPage(_addressFilter, HI__(ga));
+            page[__LO(ga) >> 3] |= (1 << (__LO(ga) & 7));
+        }
+    }
+    _addressFilter.available = true;
+    DEBUG_PRINTLN(F("AddressFilter: %d pages"), pagesNb);
+}
+
 /**************************************************************************/
 /*!
  *  @brief  Starts KNX KonnektingDevice, as well as KNX Device
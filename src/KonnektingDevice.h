@@ -194,6 +194,45 @@ typedef struct AddressTable {
     word* address;
 };
 
+/**
+ * Index of the association table (sorted by address id) per address id :
+ * the com objects of address id n are coId[offset[n]] to coId[offset[n+1]-1]
+ */
+typedef struct AssociationIndex {
+    byte* offset;       // addressTable.size + 1 entries, NULL if not available
+};
+
+/**
+ * Two-level bitmap of the assigned group addresses (i.e. GAs with at least one association),
+ * for a constant time check of the received GA before sending the ACK
+ */
+typedef struct AddressFilter {
+    bool available;     // false if the filter could not be built (memory allocation failure)
+    byte hiMap[32];     // 1 bit per GA high byte, set if at least one assigned GA has this high byte
+    byte hiRank[32];    // nb of bits set in hiMap before each byte of hiMap, to get the page of a high byte
+    byte* pages;        // 32 bytes page per bit set in hiMap, 1 bit per GA low byte
+};
+
+// Bits set in the low bits of a byte, used to get the page of a GA high byte in constant time
+inline byte addressFilterBitCount(byte b) {
+    static const byte nibbleBits[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+    return nibbleBits[b & 0x0F] + nibbleBits[b >> 4];
+}
+
+// Page of a GA high byte (the high byte shall be set in hiMap)
+inline byte* getAddressFilterPage(const AddressFilter& filter, byte gaHi) {
+    byte rank = filter.hiRank[gaHi >> 3] + addressFilterBitCount(filter.hiMap[gaHi >> 3] & ((1 << (gaHi & 7)) - 1));
+    return filter.pages + (rank * 32);
+}
+
+// true if the GA is assigned (constant time)
+inline bool isAddressInFilter(const AddressFilter& filter, word ga) {
+    byte gaHi = HI__(ga);
+    byte gaLo = __LO(ga);
+    if (!(filter.hiMap[gaHi >> 3] & (1 << (gaHi & 7)))) return false;
+    return getAddressFilterPage(filter, gaHi)[gaLo >> 3] & (1 << (gaLo & 7));
+}
+
 /**
  * see https://wiki.konnekting.de/index.php?title=KONNEKTING_Protocol_Specification_0x01#0x28_DataWritePrepare
  */
@@ -211,6 +250,7 @@ typedef struct DataWrite {
 class KonnektingDevice {
 
     friend class KnxTpUart;
+    friend class KnxHostTest;  // host side tests (extras/test)
     //friend boolean KnxTpUart:IsAddressAssigned(word addr, ArrayList<byte> &indexList) const;
 
     static byte _paramSizeList[];
@@ -224,9 +264,13 @@ class KonnektingDevice {
      */
     static AddressTable _addressTable;
     /**
-     * maximum number of associations of single group address, depends on the programming via suite and the assiciations a usedr set up
-    */
-    static byte _assocMaxTableEntries;
+     * slice of the association table for each address id
+     */
+    static AssociationIndex _associationIndex;
+    /**
+     * membership bitmap of the assigned GAs, built from the address and association tables
+     */
+    static AddressFilter _addressFilter;
 
     byte (*_eepromReadFunc)(int);
     void (*_eepromWriteFunc)(int, byte);
@@ -334,6 +378,8 @@ class KonnektingDevice {
     KnxComObject createProgComObject();
 
     void internalInit(HardwareSerial &serial, word manufacturerID, byte deviceID, byte revisionID);
+    void buildAssociationIndex();
+    void buildAddressFilter();
     int calcParamSkipBytes(int index);
 
     void reboot();